@@ -0,0 +1,164 @@
+// Counts heap allocations per received message: Socket::Receive returning a
+// new string, Socket::Receive into a reused buffer and the server receive
+// path, which takes request buffers from its pool. Allocations of the
+// sending threads aren't counted.
+
+#include <sys/socket.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include "bench/connect.h"
+#include "include/net/address.h"
+#include "include/net/client.h"
+#include "include/net/message.h"
+#include "include/net/server.h"
+#include "include/net/socket.h"
+
+namespace {
+
+std::atomic<size_t> allocations_count = 0;
+thread_local bool is_counted = true;
+
+}  // namespace
+
+void* operator new(size_t size) {
+  if (is_counted) {
+    allocations_count.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  void* memory = std::malloc(size == 0 ? 1 : size);
+  if (memory == nullptr) {
+    throw std::bad_alloc();
+  }
+  return memory;
+}
+
+// not inlined, GCC would take the free of memory from operator new for a
+// mismatch otherwise
+__attribute__((noinline)) void operator delete(void* memory) noexcept {
+  std::free(memory);
+}
+
+__attribute__((noinline)) void operator delete(void* memory, size_t) noexcept {
+  std::free(memory);
+}
+
+namespace {
+
+constexpr unsigned kPort = 9'732;
+constexpr size_t kMessages = 100'000;
+constexpr size_t kWarmupMessages = 10'000;
+// requests in flight to the server, the steady state of a pipelining client
+constexpr size_t kWindow = 256;
+// long enough not to fit into the small string buffer
+const std::string kMessage(100, 'x');
+
+template <class Receiver>
+double MeasureSocketAllocations(Receiver receiver) {
+  int descriptors[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, descriptors) < 0) {
+    throw std::runtime_error("can't create socket pair");
+  }
+
+  net::Socket writer(descriptors[0], AF_UNIX);
+  net::Socket reader(descriptors[1], AF_UNIX);
+
+  std::thread writer_thread([&writer] {
+    is_counted = false;
+    for (size_t i = 0; i < kWarmupMessages + kMessages; ++i) {
+      writer.Send(kMessage, -1);
+    }
+  });
+
+  for (size_t i = 0; i < kWarmupMessages; ++i) {
+    receiver(reader);
+  }
+
+  size_t before = allocations_count;
+  for (size_t i = 0; i < kMessages; ++i) {
+    receiver(reader);
+  }
+  size_t allocations = allocations_count - before;
+
+  writer_thread.join();
+
+  return static_cast<double>(allocations) / kMessages;
+}
+
+double MeasureServerAllocations() {
+  std::atomic<size_t> processed = 0;
+
+  net::ServerOptions options;
+  options.reactors_count = 1;
+  options.workers_count = 1;
+  options.log_level = net::LogLevel::kSilent;
+
+  net::Server server(options);
+  std::thread server_thread([&] {
+    server.Serve(net::Address("localhost", kPort),
+                 [&processed](std::shared_ptr<net::Socket>,
+                              const std::string& request) -> net::Message {
+                   if (request.size() == kMessage.size()) {
+                     ++processed;
+                   }
+                   return {};
+                 });
+  });
+
+  is_counted = false;
+  auto client = ConnectWhenListening(net::Address("localhost", kPort));
+
+  auto send = [&](size_t count) {
+    for (size_t sent = 0; sent < count; sent += kWindow) {
+      size_t target = processed + kWindow;
+      for (size_t i = 0; i < kWindow; ++i) {
+        if (client->Send(kMessage, -1) != net::Status::kOk) {
+          throw std::runtime_error("can't send request");
+        }
+      }
+      while (processed != target) {
+        std::this_thread::yield();
+      }
+    }
+  };
+
+  send(kWarmupMessages);
+  size_t before = allocations_count;
+  send(kMessages);
+  size_t allocations = allocations_count - before;
+
+  server.Stop();
+  server_thread.join();
+  is_counted = true;
+
+  return static_cast<double>(allocations) / kMessages;
+}
+
+}  // namespace
+
+int main() {
+  std::cout << "Socket::Receive, allocations/message: "
+            << MeasureSocketAllocations(
+                   [](net::Socket& socket) { socket.Receive(-1); })
+            << std::endl;
+
+  std::string buffer;
+  std::cout << "Socket::Receive into a buffer, allocations/message: "
+            << MeasureSocketAllocations([&buffer](net::Socket& socket) {
+                 socket.Receive(buffer, -1);
+               })
+            << std::endl;
+
+  std::cout << "server receive path, allocations/message: "
+            << MeasureServerAllocations() << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,165 @@
+// Compares requests per second of a single connection waiting for every
+// response before sending the next request with the asynchronous client
+// keeping a window of requests in flight. Round trips bound the former, the
+// latter approaches the throughput of the server.
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include "bench/connect.h"
+#include "include/net/address.h"
+#include "include/net/async_client.h"
+#include "include/net/client.h"
+#include "include/net/message.h"
+#include "include/net/server.h"
+#include "include/net/socket.h"
+
+namespace {
+
+constexpr unsigned kPort = 9'735;
+constexpr size_t kRequests = 100'000;
+const std::string kRequest = "count;hello";
+
+double MeasureSynchronous() {
+  auto client = ConnectWhenListening(net::Address("localhost", kPort));
+
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < kRequests; ++i) {
+    if (client->Send(kRequest) != net::Status::kOk ||
+        client->Receive().status != net::Status::kOk) {
+      throw std::runtime_error("request failed");
+    }
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+
+  return kRequests / std::chrono::duration<double>(elapsed).count();
+}
+
+// The server answers sends as well, e.g. with an error, and the replies must
+// reach the subscriber rather than be dropped.
+void CheckSendReplyIsPushed() {
+  // outlives the client, whose thread may still be pushing
+  std::promise<net::FrameHeader> pushed;
+  auto client = ConnectWhenListening<net::AsyncClient>(
+      net::Address("localhost", kPort));
+
+  client->Subscribe([&pushed](const std::string& message,
+                              const net::FrameHeader& header) {
+    if (message == kRequest) {
+      pushed.set_value(header);
+    }
+  });
+  client->Send(kRequest);
+
+  auto reply = pushed.get_future();
+  if (reply.wait_for(std::chrono::seconds(5)) != std::future_status::ready ||
+      reply.get().request_id == 0) {
+    throw std::runtime_error("reply to a send isn't pushed");
+  }
+  client->Close();
+}
+
+// Every response sends the next request, so the window stays full.
+double MeasureAsynchronous(size_t window) {
+  auto client = ConnectWhenListening<net::AsyncClient>(
+      net::Address("localhost", kPort));
+
+  std::mutex mutex;
+  std::condition_variable done;
+  size_t sent = 0;
+  size_t received = 0;
+  bool is_failed = false;
+
+  std::function<void(net::Status, std::string)> on_response =
+      [&](net::Status status, std::string) {
+        bool is_next = false;
+        {
+          std::lock_guard lock(mutex);
+          is_failed = is_failed || status != net::Status::kOk;
+          ++received;
+          if (sent < kRequests && !is_failed) {
+            ++sent;
+            is_next = true;
+          }
+          if (received == kRequests || is_failed) {
+            done.notify_one();
+          }
+        }
+        if (is_next) {
+          client->Request(kRequest, on_response);
+        }
+      };
+
+  auto start = std::chrono::steady_clock::now();
+  {
+    std::lock_guard lock(mutex);
+    sent = window;
+  }
+  for (size_t i = 0; i < window; ++i) {
+    client->Request(kRequest, on_response);
+  }
+  {
+    std::unique_lock lock(mutex);
+    done.wait(lock, [&] { return received == kRequests || is_failed; });
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  // the last callback may still be running
+  client->Close();
+
+  if (is_failed) {
+    throw std::runtime_error("request failed");
+  }
+  return kRequests / std::chrono::duration<double>(elapsed).count();
+}
+
+}  // namespace
+
+int main() {
+  net::ServerOptions options;
+  options.reactors_count = 1;
+  options.workers_count = 1;
+  options.log_level = net::LogLevel::kSilent;
+
+  net::Server server(options);
+  std::exception_ptr server_error;
+  std::thread server_thread([&] {
+    try {
+      server.Serve(net::Address("localhost", kPort),
+                   [](std::shared_ptr<net::Socket>, const std::string& request)
+                       -> net::Message { return request; });
+    } catch (...) {
+      server_error = std::current_exception();
+    }
+  });
+
+  try {
+    CheckSendReplyIsPushed();
+
+    std::cout << "client | window | requests/s" << std::endl;
+    std::cout << "synchronous | 1 | " << MeasureSynchronous() << std::endl;
+    for (size_t window : {1, 16, 256}) {
+      std::cout << "asynchronous | " << window << " | "
+                << MeasureAsynchronous(window) << std::endl;
+    }
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+  }
+
+  server.Stop();
+  server_thread.join();
+  if (server_error) {
+    std::rethrow_exception(server_error);
+  }
+
+  return 0;
+}
@@ -0,0 +1,34 @@
+#ifndef CPP_LINUX_SOCKETS_APP_BENCH_CONNECT_H_
+#define CPP_LINUX_SOCKETS_APP_BENCH_CONNECT_H_
+
+#include <chrono>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <thread>
+
+#include "include/net/address.h"
+#include "include/net/client.h"
+
+// Benchmarks start their server in another thread, so the first attempts to
+// connect may come before it listens. Retries for about a second, then
+// rethrows the last error. Client is net::Client or net::AsyncClient.
+template <typename Client = net::Client>
+std::unique_ptr<Client> ConnectWhenListening(const net::Address& address) {
+  constexpr size_t kMaxAttempts = 100;
+
+  for (size_t attempt = 0;; ++attempt) {
+    try {
+      auto client = std::make_unique<Client>(address.GetAddressFamily());
+      client->Connect(address);
+      return client;
+    } catch (const std::exception&) {
+      if (attempt == kMaxAttempts) {
+        throw;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+  }
+}
+
+#endif  // CPP_LINUX_SOCKETS_APP_BENCH_CONNECT_H_
@@ -0,0 +1,116 @@
+// Compares letter counting of the count command: the former unordered_map
+// implementation, which is reimplemented here, and every LetterCounter kernel
+// on one thread and on all of the cores.
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "include/letter_counter.h"
+
+namespace {
+
+using Counts = std::vector<std::pair<char, size_t>>;
+
+// former implementation: hashed insert per character, then a second scan
+// with find and erase for the order of first occurrence
+Counts LegacyCount(const std::string& text) {
+  std::unordered_map<char, size_t> counts;
+  for (char c : text) {
+    if (std::isalpha(c)) {
+      ++counts[c];
+    }
+  }
+
+  Counts result;
+  for (char c : text) {
+    auto pos = counts.find(c);
+    if (pos == counts.end()) {
+      continue;
+    }
+
+    result.emplace_back(c, pos->second);
+    counts.erase(pos);
+  }
+
+  return result;
+}
+
+std::string MakeText(size_t size) {
+  const std::string alphabet =
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789 .,;!?";
+
+  std::mt19937 random(42);
+  std::uniform_int_distribution<size_t> distribution(0, alphabet.size() - 1);
+
+  std::string text(size, '\0');
+  for (char& c : text) {
+    c = alphabet[distribution(random)];
+  }
+  return text;
+}
+
+template <class Counter>
+double MeasureMegabytesPerSecond(const std::string& text, Counter counter) {
+  const Counts expected = LegacyCount(text);
+
+  size_t iterations = std::max<size_t>(1, (256 << 20) / text.size());
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < iterations; ++i) {
+    if (counter(text) != expected) {
+      throw std::runtime_error("counts differ from the former ones");
+    }
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+
+  double seconds = std::chrono::duration<double>(elapsed).count();
+  return iterations * text.size() / seconds / (1 << 20);
+}
+
+}  // namespace
+
+int main() {
+  std::vector<std::pair<std::string, LetterCounter::Kernel>> kernels = {
+      {"scalar", LetterCounter::Kernel::kScalar},
+      {"sse2", LetterCounter::Kernel::kSse2},
+      {"avx2", LetterCounter::Kernel::kAvx2}};
+
+  for (size_t size : {1'024, 64 * 1'024, 64 * 1'024 * 1'024}) {
+    std::string text = MakeText(size);
+    std::cout << "text of " << size << " bytes, MB/s" << std::endl;
+
+    std::cout << "  unordered_map | "
+              << MeasureMegabytesPerSecond(text, LegacyCount) << std::endl;
+
+    for (const auto& [name, kernel] : kernels) {
+      if (!LetterCounter::IsSupported(kernel)) {
+        std::cout << "  " << name << " | not supported" << std::endl;
+        continue;
+      }
+
+      LetterCounter single_threaded(kernel, 1);
+      LetterCounter multi_threaded(kernel);
+      auto count_single_threaded = [&](const std::string& t) {
+        return single_threaded.Count(t);
+      };
+      auto count_multi_threaded = [&](const std::string& t) {
+        return multi_threaded.Count(t);
+      };
+      std::cout << "  " << name << " | "
+                << MeasureMegabytesPerSecond(text, count_single_threaded)
+                << " | all cores "
+                << MeasureMegabytesPerSecond(text, count_multi_threaded)
+                << std::endl;
+    }
+  }
+
+  return 0;
+}
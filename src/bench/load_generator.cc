@@ -0,0 +1,268 @@
+// Load generator for a running server. Every connection is driven by its own
+// thread with a weighted random mix of commands, either in closed loop, with
+// the next request sent as soon as the previous response arrives, or at a
+// fixed total rate. At a fixed rate latencies are measured from the time a
+// request was due rather than from the time it was sent, so a stalled server
+// isn't hidden by the requests it delayed.
+//
+// load_generator <address> <port> [--connections=<count>]
+//     [--duration=<sec>] [--rate=<requests/s>] [--message-size=<bytes>]
+//     [--mix=<command>:<weight>,...]
+
+#include <sys/socket.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "include/net/address.h"
+#include "include/net/client.h"
+#include "include/net/frame.h"
+#include "include/net/socket.h"
+#include "include/net/stats.h"
+#include "include/processor.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int kResponseTimeoutMsec = 5'000;
+
+struct Options {
+  std::string address;
+  // or the path of a Unix domain socket
+  std::string port;
+  size_t connections = 8;
+  std::chrono::seconds duration{10};
+  // total over all connections, 0 means closed loop
+  double rate = 0;
+  size_t message_size = 32;
+  std::string mix = "count:8,connections:1,send:1";
+};
+
+struct CommandLoad {
+  std::string name;
+  unsigned weight;
+  // serialized once, every connection sends the same bytes
+  std::string request;
+  // `send` gets no response, it's timed up to the end of the write
+  bool has_response;
+
+  std::unique_ptr<net::LatencyHistogram> latencies;
+};
+
+Options ParseOptions(int argc, char** argv) {
+  Options options;
+  options.address = argv[1];
+  options.port = argv[2];
+
+  for (int i = 3; i < argc; ++i) {
+    std::string option = argv[i];
+    auto equals_pos = option.find('=');
+    std::string name = option.substr(0, equals_pos);
+    std::string value =
+        equals_pos == std::string::npos ? "" : option.substr(equals_pos + 1);
+
+    if (name == "--connections") {
+      options.connections = std::stoul(value);
+    } else if (name == "--duration") {
+      options.duration = std::chrono::seconds(std::stoul(value));
+    } else if (name == "--rate") {
+      options.rate = std::stod(value);
+    } else if (name == "--message-size") {
+      options.message_size = std::stoul(value);
+    } else if (name == "--mix") {
+      options.mix = value;
+    } else {
+      throw std::invalid_argument("unknown option: " + name);
+    }
+  }
+
+  if (options.connections == 0) {
+    throw std::invalid_argument("there must be at least one connection");
+  }
+  return options;
+}
+
+std::vector<CommandLoad> MakeCommands(const Options& options) {
+  Processor processor;
+  std::string message(options.message_size, 'a');
+  for (size_t i = 0; i < message.size(); ++i) {
+    message[i] = static_cast<char>('a' + i % 26);
+  }
+
+  std::vector<CommandLoad> commands;
+  std::stringstream mix(options.mix);
+  std::string entry;
+  while (std::getline(mix, entry, ',')) {
+    auto colon_pos = entry.find(':');
+    if (colon_pos == std::string::npos) {
+      throw std::invalid_argument("mix entry must be <command>:<weight>");
+    }
+
+    std::string name = entry.substr(0, colon_pos);
+    unsigned weight = std::stoul(entry.substr(colon_pos + 1));
+    if (name != "count" && name != "connections" && name != "send") {
+      throw std::invalid_argument("unknown command: " + name);
+    }
+
+    commands.push_back(CommandLoad{
+        name, weight,
+        processor.Serialize(name, name == "connections" ? "" : message),
+        name != "send", std::make_unique<net::LatencyHistogram>()});
+  }
+
+  if (commands.empty()) {
+    throw std::invalid_argument("mix is empty");
+  }
+  return commands;
+}
+
+// Returns the number of requests which failed.
+uint64_t RunConnection(const Options& options, const net::Address& address,
+                       size_t index, Clock::time_point end,
+                       std::vector<CommandLoad>& commands) {
+  net::Client client(address.GetAddressFamily());
+  // request ids tell responses apart from broadcasts of other connections
+  client.Connect(address, net::Framing::kBinary);
+
+  std::vector<unsigned> weights;
+  for (const auto& command : commands) {
+    weights.push_back(command.weight);
+  }
+  std::mt19937 random(index);
+  std::discrete_distribution<size_t> pick(weights.begin(), weights.end());
+
+  Clock::duration interval(0);
+  if (options.rate > 0) {
+    interval = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(options.connections / options.rate));
+  }
+
+  std::string response;
+  net::FrameHeader response_header;
+  uint32_t request_id = 0;
+  Clock::time_point due = Clock::now();
+  while (true) {
+    if (interval != Clock::duration(0)) {
+      std::this_thread::sleep_until(due);
+    } else {
+      due = Clock::now();
+    }
+    if (due >= end) {
+      return 0;
+    }
+
+    // broadcasts of the send command of other connections, a connection
+    // which only sends would never read them and the server would end up
+    // dropping them or disconnecting it
+    net::Status drained;
+    do {
+      drained = client.Receive(response, response_header, 0);
+    } while (drained == net::Status::kOk);
+    if (drained == net::Status::kClosed) {
+      return 1;
+    }
+
+    size_t command_index = pick(random);
+    CommandLoad& command = commands[command_index];
+    net::FrameHeader header{++request_id,
+                            static_cast<uint16_t>(command_index), 0};
+    if (client.Send(command.request, header) != net::Status::kOk) {
+      return 1;
+    }
+
+    while (command.has_response) {
+      if (client.Receive(response, response_header, kResponseTimeoutMsec) !=
+          net::Status::kOk) {
+        return 1;
+      }
+      if (response_header.request_id == header.request_id) {
+        break;
+      }
+      // broadcasts of the send command of other connections
+    }
+
+    command.latencies->Record(Clock::now() - due);
+    due += interval;
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc < 3) {
+    std::cerr << "There must be two parameters: address and port, or unix and "
+                 "socket path"
+              << std::endl;
+    return 1;
+  }
+
+  try {
+    Options options = ParseOptions(argc, argv);
+    std::vector<CommandLoad> commands = MakeCommands(options);
+    net::Address address = options.address == "unix"
+                                ? net::Address::FromPath(options.port)
+                                : net::Address(options.address,
+                                               std::stoi(options.port));
+
+    std::atomic<uint64_t> errors = 0;
+    auto start = Clock::now();
+    auto end = start + options.duration;
+
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < options.connections; ++i) {
+      threads.emplace_back([&, i] {
+        try {
+          errors += RunConnection(options, address, i, end, commands);
+        } catch (const std::exception& e) {
+          std::cerr << "Connection " << i << ": " << e.what() << std::endl;
+          ++errors;
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    auto elapsed = std::chrono::duration<double>(Clock::now() - start);
+
+    uint64_t requests = 0;
+    for (const auto& command : commands) {
+      requests += command.latencies->Read().GetCount();
+    }
+
+    auto to_microseconds = [](std::chrono::nanoseconds latency) {
+      return std::chrono::duration<double, std::micro>(latency).count();
+    };
+    std::cout << "connections | " << options.connections << "\n"
+              << "seconds | " << elapsed.count() << "\n"
+              << "requests | " << requests << "\n"
+              << "requests/s | " << requests / elapsed.count() << "\n"
+              << "errors | " << errors << "\n"
+              << "command | requests | p50, us | p99, us | p999, us | max, us"
+              << std::endl;
+    for (const auto& command : commands) {
+      auto latencies = command.latencies->Read();
+      std::cout << command.name << " | " << latencies.GetCount() << " | "
+                << to_microseconds(latencies.GetPercentile(50)) << " | "
+                << to_microseconds(latencies.GetPercentile(99)) << " | "
+                << to_microseconds(latencies.GetPercentile(99.9)) << " | "
+                << to_microseconds(latencies.GetMax()) << std::endl;
+    }
+
+    return errors == 0 ? 0 : 1;
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+}
@@ -0,0 +1,78 @@
+// Measures the cost of a single wakeup of every poller backend while the
+// number of idle registered connections grows. Only one connection is active,
+// so an O(ready) backend should stay flat.
+
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "include/net/poller.h"
+
+namespace {
+
+constexpr size_t kWakeups = 20'000;
+
+double MeasureWakeupNsec(net::PollerType type, size_t idle_connections) {
+  auto poller = net::Poller::Create(type);
+
+  std::vector<std::pair<int, int>> pairs(idle_connections + 1);
+  for (auto& pair : pairs) {
+    int descriptors[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, descriptors) < 0) {
+      throw std::runtime_error("can't create socket pair");
+    }
+    pair = {descriptors[0], descriptors[1]};
+    poller->Add(pair.first);
+  }
+
+  // the active connection is registered last, the worst case for poll
+  auto [active, peer] = pairs.back();
+  std::vector<net::PollEvent> events;
+  char byte = 'x';
+
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < kWakeups; ++i) {
+    if (write(peer, &byte, 1) != 1 || poller->Wait(events, -1) != 1 ||
+        read(active, &byte, 1) != 1) {
+      throw std::runtime_error("unexpected wakeup");
+    }
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+
+  for (auto& pair : pairs) {
+    close(pair.first);
+    close(pair.second);
+  }
+
+  return std::chrono::duration<double, std::nano>(elapsed).count() / kWakeups;
+}
+
+}  // namespace
+
+int main() {
+  struct rlimit limit;
+  getrlimit(RLIMIT_NOFILE, &limit);
+  limit.rlim_cur = limit.rlim_max;
+  setrlimit(RLIMIT_NOFILE, &limit);
+
+  std::cout << "idle connections | poll, ns/wakeup | epoll, ns/wakeup | "
+               "io_uring, ns/wakeup"
+            << std::endl;
+  for (size_t idle = 0; idle * 2 + 16 < limit.rlim_cur;
+       idle = idle == 0 ? 16 : idle * 4) {
+    std::cout << idle << " | "
+              << MeasureWakeupNsec(net::PollerType::kPoll, idle) << " | "
+              << MeasureWakeupNsec(net::PollerType::kEpoll, idle) << " | "
+              << MeasureWakeupNsec(net::PollerType::kUring, idle) << std::endl;
+  }
+
+  return 0;
+}
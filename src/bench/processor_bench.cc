@@ -0,0 +1,66 @@
+// Measures every Processor operation on a typical request: the copying ones
+// and their allocation-free counterparts, in nanoseconds per call.
+
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+#include "include/processor.h"
+
+namespace {
+
+constexpr size_t kIterations = 5'000'000;
+const std::string kCommand = "count";
+const std::string kArgument = "hello, this is a message to be counted";
+const std::string kRequest = kCommand + ";" + kArgument;
+const std::string kInput = "  " + kCommand + "   " + kArgument;
+
+// Keeps the compiler from dropping the results.
+size_t sink = 0;
+
+template <class Operation>
+void PrintNanosecondsPerCall(std::string_view name, Operation operation) {
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < kIterations; ++i) {
+    sink += operation();
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+
+  std::cout << name << " | "
+            << std::chrono::duration<double, std::nano>(elapsed).count() /
+                   kIterations
+            << std::endl;
+}
+
+}  // namespace
+
+int main() {
+  Processor processor;
+  std::string output;
+
+  std::cout << "operation | ns/call" << std::endl;
+  PrintNanosecondsPerCall("Serialize", [&] {
+    return processor.Serialize(kCommand, kArgument).size();
+  });
+  PrintNanosecondsPerCall("SerializeTo", [&] {
+    output.clear();
+    processor.SerializeTo(output, kCommand, kArgument);
+    return output.size();
+  });
+  PrintNanosecondsPerCall("Deserialize", [&] {
+    return processor.Deserialize(kRequest).second.size();
+  });
+  PrintNanosecondsPerCall("DeserializeView", [&] {
+    return processor.DeserializeView(kRequest).second.size();
+  });
+  PrintNanosecondsPerCall("UnpackCommand", [&] {
+    return processor.UnpackCommand(kInput).second.size();
+  });
+  PrintNanosecondsPerCall("UnpackCommandView", [&] {
+    return processor.UnpackCommandView(kInput).second.size();
+  });
+
+  return sink == 0 ? 1 : 0;
+}
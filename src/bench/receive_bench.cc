@@ -0,0 +1,99 @@
+// Compares receiving of small messages by the buffered Socket::Receive with
+// the former byte-at-a-time header parsing, which is reimplemented here.
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include "include/net/socket.h"
+
+namespace {
+
+constexpr size_t kMessages = 200'000;
+const std::string kMessage = "count;hello";
+
+// former implementation: poll and recv for every header byte, then poll and
+// recv for the body
+std::string LegacyReceive(int file_descriptor) {
+  struct pollfd fds[1];
+  fds[0].fd = file_descriptor;
+  fds[0].events = POLLIN;
+
+  std::string header;
+  while (header.empty() || header.back() != ';') {
+    char c;
+    if (poll(fds, 1, -1) != 1 || recv(file_descriptor, &c, 1, 0) != 1) {
+      throw std::runtime_error("can't read header");
+    }
+    header.push_back(c);
+  }
+
+  std::string result(std::stoull(header), '\0');
+  size_t readed_bytes = 0;
+  while (readed_bytes != result.size()) {
+    if (poll(fds, 1, -1) != 1) {
+      throw std::runtime_error("can't poll");
+    }
+    ssize_t n = recv(file_descriptor, result.data() + readed_bytes,
+                     result.size() - readed_bytes, 0);
+    if (n <= 0) {
+      throw std::runtime_error("can't read body");
+    }
+    readed_bytes += n;
+  }
+
+  return result;
+}
+
+template <class Receiver>
+double MeasureMessagesPerSecond(Receiver receiver) {
+  int descriptors[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, descriptors) < 0) {
+    throw std::runtime_error("can't create socket pair");
+  }
+
+  net::Socket writer(descriptors[0], AF_UNIX);
+  net::Socket reader(descriptors[1], AF_UNIX);
+
+  std::thread writer_thread([&writer] {
+    for (size_t i = 0; i < kMessages; ++i) {
+      writer.Send(kMessage, -1);
+    }
+  });
+
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < kMessages; ++i) {
+    if (receiver(reader) != kMessage) {
+      throw std::runtime_error("unexpected message");
+    }
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+
+  writer_thread.join();
+
+  return kMessages / std::chrono::duration<double>(elapsed).count();
+}
+
+}  // namespace
+
+int main() {
+  std::cout << "byte-at-a-time header, messages/s: "
+            << MeasureMessagesPerSecond([](net::Socket& socket) {
+                 return LegacyReceive(socket.GetFileDescriptor());
+               })
+            << std::endl;
+  std::cout << "buffered receive, messages/s: "
+            << MeasureMessagesPerSecond([](net::Socket& socket) {
+                 return socket.Receive(-1).data;
+               })
+            << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,103 @@
+// Compares request round trips per second of the server on loopback with
+// every poller backend. Clients pipeline small requests in windows, so each
+// wakeup of the event loop carries several of them.
+
+#include <chrono>
+#include <cstddef>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench/connect.h"
+#include "include/net/address.h"
+#include "include/net/client.h"
+#include "include/net/message.h"
+#include "include/net/poller.h"
+#include "include/net/server.h"
+#include "include/net/socket.h"
+
+namespace {
+
+constexpr unsigned kPort = 9'731;
+constexpr size_t kClients = 8;
+constexpr size_t kWindow = 16;
+constexpr size_t kRequestsPerClient = 20'000;
+const std::string kRequest = "count;hello";
+
+void RunClient(net::Client& client) {
+  for (size_t sent = 0; sent < kRequestsPerClient; sent += kWindow) {
+    for (size_t i = 0; i < kWindow; ++i) {
+      if (client.Send(kRequest) != net::Status::kOk) {
+        throw std::runtime_error("can't send request");
+      }
+    }
+    for (size_t i = 0; i < kWindow; ++i) {
+      if (client.Receive().status != net::Status::kOk) {
+        throw std::runtime_error("can't receive response");
+      }
+    }
+  }
+}
+
+double MeasureRequestsPerSecond(net::PollerType type) {
+  net::ServerOptions options;
+  options.poller_type = type;
+  options.reactors_count = 1;
+  options.workers_count = 1;
+  options.log_level = net::LogLevel::kSilent;
+
+  net::Server server(options);
+  std::exception_ptr server_error;
+  std::thread server_thread([&] {
+    try {
+      server.Serve(net::Address("localhost", kPort),
+                   [](std::shared_ptr<net::Socket>, const std::string& request)
+                       -> net::Message { return request; });
+    } catch (...) {
+      server_error = std::current_exception();
+    }
+  });
+
+  std::vector<std::unique_ptr<net::Client>> clients;
+  for (size_t i = 0; i < kClients; ++i) {
+    clients.push_back(
+        ConnectWhenListening(net::Address("localhost", kPort)));
+  }
+  // the event loop is running once the first response has arrived
+  RunClient(*clients.front());
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> client_threads;
+  for (auto& client : clients) {
+    client_threads.emplace_back([&client] { RunClient(*client); });
+  }
+  for (auto& thread : client_threads) {
+    thread.join();
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+
+  server.Stop();
+  server_thread.join();
+  if (server_error) {
+    std::rethrow_exception(server_error);
+  }
+
+  return kClients * kRequestsPerClient /
+         std::chrono::duration<double>(elapsed).count();
+}
+
+}  // namespace
+
+int main() {
+  std::cout << "poll, requests/s | epoll, requests/s | io_uring, requests/s"
+            << std::endl;
+  std::cout << MeasureRequestsPerSecond(net::PollerType::kPoll) << " | "
+            << MeasureRequestsPerSecond(net::PollerType::kEpoll) << " | "
+            << MeasureRequestsPerSecond(net::PollerType::kUring) << std::endl;
+
+  return 0;
+}
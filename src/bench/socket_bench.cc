@@ -0,0 +1,93 @@
+// Measures Socket::Send and Socket::Receive over a socket pair for several
+// message sizes: one-way throughput, with a writer thread streaming messages
+// to the reader, and ping-pong round trips of a single message.
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include "include/net/socket.h"
+
+namespace {
+
+constexpr size_t kStreamedBytes = 64 * 1'024 * 1'024;
+constexpr size_t kMaxStreamedMessages = 1'000'000;
+constexpr size_t kRoundTrips = 50'000;
+
+// Messages per second received one way.
+double MeasureStream(size_t message_size) {
+  auto [writer, reader] = net::Socket::MakePair();
+  std::string message(message_size, 'x');
+  size_t messages = std::min(kStreamedBytes / message_size,
+                             kMaxStreamedMessages);
+
+  std::thread writer_thread([&writer = writer, &message, messages] {
+    for (size_t i = 0; i < messages; ++i) {
+      if (writer.Send(message, -1) != net::Status::kOk) {
+        throw std::runtime_error("can't send message");
+      }
+    }
+  });
+
+  std::string received;
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < messages; ++i) {
+    if (reader.Receive(received, -1) != net::Status::kOk ||
+        received.size() != message_size) {
+      throw std::runtime_error("can't receive message");
+    }
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+
+  writer_thread.join();
+  return messages / std::chrono::duration<double>(elapsed).count();
+}
+
+// Average round trip in microseconds.
+double MeasurePingPong(size_t message_size) {
+  auto [client, peer] = net::Socket::MakePair();
+  std::string message(message_size, 'x');
+
+  std::thread echo_thread([&peer = peer] {
+    std::string echoed;
+    for (size_t i = 0; i < kRoundTrips; ++i) {
+      if (peer.Receive(echoed, -1) != net::Status::kOk ||
+          peer.Send(echoed, -1) != net::Status::kOk) {
+        throw std::runtime_error("can't echo message");
+      }
+    }
+  });
+
+  std::string received;
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < kRoundTrips; ++i) {
+    if (client.Send(message, -1) != net::Status::kOk ||
+        client.Receive(received, -1) != net::Status::kOk) {
+      throw std::runtime_error("can't make round trip");
+    }
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+
+  echo_thread.join();
+  return std::chrono::duration<double, std::micro>(elapsed).count() /
+         kRoundTrips;
+}
+
+}  // namespace
+
+int main() {
+  std::cout << "message, bytes | messages/s | MiB/s | round trip, us"
+            << std::endl;
+  for (size_t message_size : {16, 1'024, 64 * 1'024}) {
+    double messages_per_second = MeasureStream(message_size);
+    std::cout << message_size << " | " << messages_per_second << " | "
+              << messages_per_second * message_size / (1'024 * 1'024) << " | "
+              << MeasurePingPong(message_size) << std::endl;
+  }
+
+  return 0;
+}
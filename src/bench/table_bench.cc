@@ -0,0 +1,103 @@
+// Compares formatting of the count table: the former stringstream
+// implementation, which is reimplemented here, and FormatCountTable with the
+// message echoed or replaced by its size, in nanoseconds per table and bytes
+// of the table.
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "include/count_table.h"
+#include "include/letter_counter.h"
+
+namespace {
+
+constexpr size_t kFormattedBytes = 256 * 1'024 * 1'024;
+constexpr size_t kMaxIterations = 1'000'000;
+
+// Keeps the compiler from dropping the results.
+size_t sink = 0;
+
+// former implementation: padding written a space at a time into a stream
+std::string LegacyTable(std::string_view message,
+                        const LetterCounter::Counts& counts) {
+  std::string message_header = "Message";
+
+  std::stringstream ss;
+  ss << message_header << " | " << message << "\n";
+  bool comma = false;
+  for (auto [c, count] : counts) {
+    if (comma) {
+      ss << "\n";
+    }
+    comma = true;
+
+    ss << c;
+    for (size_t i = 0; i < message_header.size() - 1; ++i) {
+      ss << ' ';
+    }
+    ss << " | " << count;
+  }
+
+  return ss.str();
+}
+
+std::string MakeMessage(size_t size) {
+  std::string message(size, '\0');
+  for (size_t i = 0; i < size; ++i) {
+    message[i] = static_cast<char>((i % 2 == 0 ? 'a' : 'A') + i * 7 % 26);
+  }
+  return message;
+}
+
+template <class Formatter>
+void PrintNanosecondsPerTable(std::string_view name, size_t message_size,
+                              Formatter formatter) {
+  size_t iterations =
+      std::max<size_t>(1, std::min(kFormattedBytes / message_size,
+                                   kMaxIterations));
+  size_t table_size = formatter().size();
+
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < iterations; ++i) {
+    sink += formatter().size();
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+
+  std::cout << "  " << name << " | "
+            << std::chrono::duration<double, std::nano>(elapsed).count() /
+                   iterations
+            << " | " << table_size << std::endl;
+}
+
+}  // namespace
+
+int main() {
+  LetterCounter counter;
+
+  for (size_t message_size : {16, 1'024, 1'024 * 1'024}) {
+    std::string message = MakeMessage(message_size);
+    LetterCounter::Counts counts = counter.Count(message);
+    std::string size = "<" + std::to_string(message_size) + " bytes>";
+
+    if (FormatCountTable(message, counts) != LegacyTable(message, counts)) {
+      throw std::runtime_error("table differs from the former one");
+    }
+
+    std::cout << "message of " << message_size << " bytes | ns/table | bytes"
+              << std::endl;
+    PrintNanosecondsPerTable("stringstream", message_size,
+                             [&] { return LegacyTable(message, counts); });
+    PrintNanosecondsPerTable("FormatCountTable", message_size,
+                             [&] { return FormatCountTable(message, counts); });
+    PrintNanosecondsPerTable("FormatCountTable, size only", message_size,
+                             [&] { return FormatCountTable(size, counts); });
+  }
+
+  return sink == 0 ? 1 : 0;
+}
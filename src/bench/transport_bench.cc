@@ -0,0 +1,141 @@
+// Compares request round trip latency of the server listening on a loopback
+// TCP port and on a Unix domain socket at the same time. A single client
+// waits for every response before sending the next request, so the numbers
+// are dominated by the transport rather than by batching. An echo over a
+// plain socket pair shows the floor without the server.
+
+#include <unistd.h>
+
+#include <chrono>
+#include <cstddef>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench/connect.h"
+#include "include/net/address.h"
+#include "include/net/client.h"
+#include "include/net/message.h"
+#include "include/net/server.h"
+#include "include/net/socket.h"
+#include "include/net/stats.h"
+
+namespace {
+
+constexpr unsigned kPort = 9'733;
+constexpr size_t kWarmupRequests = 1'000;
+constexpr size_t kRequests = 50'000;
+const std::string kRequest = "count;hello";
+
+std::string GetSocketPath() {
+  return "/tmp/transport_bench_" + std::to_string(getpid()) + ".sock";
+}
+
+void RoundTrip(net::Client& client) {
+  if (client.Send(kRequest) != net::Status::kOk) {
+    throw std::runtime_error("can't send request");
+  }
+  if (client.Receive().status != net::Status::kOk) {
+    throw std::runtime_error("can't receive response");
+  }
+}
+
+void RoundTrip(net::Socket& socket) {
+  if (socket.Send(kRequest) != net::Status::kOk) {
+    throw std::runtime_error("can't send request");
+  }
+  if (socket.Receive().status != net::Status::kOk) {
+    throw std::runtime_error("can't receive response");
+  }
+}
+
+template <typename Connection>
+void PrintLatencies(const std::string& name, Connection& connection) {
+  for (size_t i = 0; i < kWarmupRequests; ++i) {
+    RoundTrip(connection);
+  }
+
+  net::LatencyHistogram latencies(1);
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < kRequests; ++i) {
+    auto request_start = std::chrono::steady_clock::now();
+    RoundTrip(connection);
+    latencies.Record(std::chrono::steady_clock::now() - request_start);
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+
+  auto to_microseconds = [](std::chrono::nanoseconds latency) {
+    return std::chrono::duration<double, std::micro>(latency).count();
+  };
+  auto snapshot = latencies.Read();
+  std::cout << name << " | "
+            << kRequests / std::chrono::duration<double>(elapsed).count()
+            << " | " << to_microseconds(snapshot.GetPercentile(50)) << " | "
+            << to_microseconds(snapshot.GetPercentile(99)) << std::endl;
+}
+
+void MeasureServer() {
+  net::ServerOptions options;
+  options.reactors_count = 1;
+  options.workers_count = 1;
+  options.log_level = net::LogLevel::kSilent;
+
+  net::Address tcp_address("localhost", kPort);
+  net::Address unix_address = net::Address::FromPath(GetSocketPath());
+
+  net::Server server(options);
+  std::exception_ptr server_error;
+  std::thread server_thread([&] {
+    try {
+      server.Serve({tcp_address, unix_address},
+                   [](std::shared_ptr<net::Socket>, const std::string& request)
+                       -> net::Message { return request; });
+    } catch (...) {
+      server_error = std::current_exception();
+    }
+  });
+
+  try {
+    PrintLatencies("tcp", *ConnectWhenListening(tcp_address));
+    PrintLatencies("unix", *ConnectWhenListening(unix_address));
+  } catch (...) {
+    server.Stop();
+    server_thread.join();
+    throw;
+  }
+
+  server.Stop();
+  server_thread.join();
+  if (server_error) {
+    std::rethrow_exception(server_error);
+  }
+}
+
+void MeasureSocketPair() {
+  auto [client, peer] = net::Socket::MakePair();
+  std::thread echo_thread([&peer = peer] {
+    std::string message;
+    while (peer.Receive(message, -1) == net::Status::kOk &&
+           peer.Send(message) == net::Status::kOk) {
+    }
+  });
+
+  PrintLatencies("socketpair, no server", client);
+
+  client.Shutdown();
+  echo_thread.join();
+}
+
+}  // namespace
+
+int main() {
+  std::cout << "transport | requests/s | p50, us | p99, us" << std::endl;
+  MeasureServer();
+  MeasureSocketPair();
+
+  return 0;
+}
@@ -0,0 +1,158 @@
+#include "include/count_cache.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#ifdef __x86_64__
+#include <immintrin.h>
+#define COUNT_CACHE_X86
+#endif
+
+namespace {
+
+// reflected Castagnoli polynomial
+constexpr uint32_t kPolynomial = 0x82F63B78;
+
+constexpr std::array<uint32_t, 256> kCrcTable = [] {
+  std::array<uint32_t, 256> table{};
+  for (uint32_t i = 0; i < table.size(); ++i) {
+    uint32_t crc = i;
+    for (int bit = 0; bit < 8; ++bit) {
+      crc = (crc >> 1) ^ (crc & 1 ? kPolynomial : 0);
+    }
+    table[i] = crc;
+  }
+  return table;
+}();
+
+uint32_t Crc32cScalar(const unsigned char* data, size_t size,
+                      uint32_t crc) noexcept {
+  for (size_t i = 0; i < size; ++i) {
+    crc = kCrcTable[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+  }
+  return crc;
+}
+
+#ifdef COUNT_CACHE_X86
+
+__attribute__((target("sse4.2"))) uint32_t Crc32cSse42(
+    const unsigned char* data, size_t size, uint32_t crc) noexcept {
+  uint64_t crc64 = crc;
+  for (; size >= sizeof(uint64_t); size -= sizeof(uint64_t)) {
+    uint64_t word;
+    std::memcpy(&word, data, sizeof(word));
+    crc64 = _mm_crc32_u64(crc64, word);
+    data += sizeof(uint64_t);
+  }
+
+  auto crc32 = static_cast<uint32_t>(crc64);
+  for (size_t i = 0; i < size; ++i) {
+    crc32 = _mm_crc32_u8(crc32, data[i]);
+  }
+  return crc32;
+}
+
+#endif  // COUNT_CACHE_X86
+
+}  // namespace
+
+CountCache::CountCache(size_t capacity)
+    : capacity_(capacity),
+      hits_(0),
+      misses_(0),
+      mutex_(),
+      entries_(),
+      entries_by_hash_(),
+      bytes_(0) {}
+
+uint32_t CountCache::Hash(std::string_view message) noexcept {
+  const auto* data = reinterpret_cast<const unsigned char*>(message.data());
+  uint32_t crc = ~uint32_t(0);
+
+#ifdef COUNT_CACHE_X86
+  static const bool is_sse42_supported = __builtin_cpu_supports("sse4.2");
+  if (is_sse42_supported) {
+    return ~Crc32cSse42(data, message.size(), crc);
+  }
+#endif
+
+  return ~Crc32cScalar(data, message.size(), crc);
+}
+
+bool CountCache::IsEnabled() const noexcept { return capacity_ != 0; }
+
+std::shared_ptr<const std::string> CountCache::Find(
+    uint32_t hash, std::string_view message) {
+  std::shared_ptr<const Entry> entry;
+  {
+    std::lock_guard lock(mutex_);
+    auto found = entries_by_hash_.find(hash);
+    if (found != entries_by_hash_.end()) {
+      entries_.splice(entries_.begin(), entries_, found->second);
+      entry = *found->second;
+    }
+  }
+
+  // large messages are compared without holding the lock, the entry stays
+  // alive even if it's evicted meanwhile
+  if (!entry || entry->message != message) {
+    misses_.fetch_add(1, std::memory_order_relaxed);
+    return nullptr;
+  }
+
+  hits_.fetch_add(1, std::memory_order_relaxed);
+  return entry->table;
+}
+
+void CountCache::Insert(uint32_t hash, std::string_view message,
+                        std::shared_ptr<const std::string> table) {
+  if (message.size() + table->size() > capacity_ / 4) {
+    return;
+  }
+
+  auto entry = std::make_shared<const Entry>(
+      Entry{hash, std::string(message), std::move(table)});
+
+  std::lock_guard lock(mutex_);
+  auto found = entries_by_hash_.find(hash);
+  if (found != entries_by_hash_.end()) {
+    Erase(found->second);
+  }
+
+  bytes_ += entry->GetSize();
+  entries_.push_front(std::move(entry));
+  entries_by_hash_.emplace(hash, entries_.begin());
+
+  while (bytes_ > capacity_) {
+    Erase(std::prev(entries_.end()));
+  }
+}
+
+CountCache::Stats CountCache::GetStats() const {
+  Stats stats;
+  stats.hits = hits_.load(std::memory_order_relaxed);
+  stats.misses = misses_.load(std::memory_order_relaxed);
+
+  std::lock_guard lock(mutex_);
+  stats.entries = entries_.size();
+  stats.bytes = bytes_;
+  return stats;
+}
+
+void CountCache::Erase(Entries::iterator entry) {
+  bytes_ -= (*entry)->GetSize();
+  entries_by_hash_.erase((*entry)->hash);
+  entries_.erase(entry);
+}
+
+size_t CountCache::Entry::GetSize() const noexcept {
+  return message.size() + table->size();
+}
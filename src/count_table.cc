@@ -0,0 +1,63 @@
+#include "include/count_table.h"
+
+#include <charconv>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+#include "include/letter_counter.h"
+
+namespace {
+
+constexpr std::string_view kMessageHeader = "Message | ";
+// letters are padded to the width of "Message"
+constexpr size_t kLetterWidth = 7;
+constexpr std::string_view kSeparator = " | ";
+constexpr size_t kRowPrefixSize = kLetterWidth + kSeparator.size();
+
+size_t CountDigits(size_t value) noexcept {
+  size_t digits = 1;
+  for (; value >= 10; value /= 10) {
+    ++digits;
+  }
+  return digits;
+}
+
+}  // namespace
+
+std::string FormatCountTable(std::string_view message,
+                             const LetterCounter::Counts& counts) {
+  size_t size = kMessageHeader.size() + message.size() + 1;
+  for (auto [c, count] : counts) {
+    size += kRowPrefixSize + CountDigits(count) + 1;
+  }
+  // rows are separated by line breaks, not terminated
+  if (!counts.empty()) {
+    --size;
+  }
+
+  // spaces are the padding, only the rest is written
+  std::string table(size, ' ');
+  char* position = table.data();
+
+  std::memcpy(position, kMessageHeader.data(), kMessageHeader.size());
+  position += kMessageHeader.size();
+  std::memcpy(position, message.data(), message.size());
+  position += message.size();
+  *position++ = '\n';
+
+  char* end = table.data() + table.size();
+  for (size_t i = 0; i < counts.size(); ++i) {
+    if (i != 0) {
+      *position++ = '\n';
+    }
+
+    position[0] = counts[i].first;
+    position[kLetterWidth + 1] = '|';
+    position = std::to_chars(position + kRowPrefixSize, end, counts[i].second)
+                   .ptr;
+  }
+
+  return table;
+}
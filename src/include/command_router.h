@@ -0,0 +1,111 @@
+#ifndef CPP_LINUX_SOCKETS_APP_INCLUDE_COMMAND_ROUTER_H_
+#define CPP_LINUX_SOCKETS_APP_INCLUDE_COMMAND_ROUTER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Command split into its name and argument, both point into the text.
+struct Command {
+  std::string_view name;
+  std::string_view argument;
+  // whole command as it was received
+  std::string_view text;
+};
+
+template <typename Signature>
+class CommandRouter;
+
+// Handlers registered under command names. Names are placed into a table by
+// a hash seeded so that no two of them collide, so finding a handler takes a
+// single hash and a single comparison regardless of the number of commands.
+template <typename Result, typename... Args>
+class CommandRouter<Result(Args...)> {
+ public:
+  using Handler = std::function<Result(Args...)>;
+
+  CommandRouter() : names_(), handlers_(), slots_(), seed_(0) {}
+
+  // Throws std::invalid_argument if the name is already registered.
+  void Register(std::string_view name, Handler handler) {
+    if (Find(name) != nullptr) {
+      throw std::invalid_argument("command is already registered: " +
+                                  std::string(name));
+    }
+
+    names_.emplace_back(name);
+    handlers_.push_back(std::move(handler));
+    Rebuild();
+  }
+
+  // Returns nullptr if there is no handler for the name.
+  const Handler* Find(std::string_view name) const noexcept {
+    if (slots_.empty()) {
+      return nullptr;
+    }
+
+    uint32_t slot = slots_[Hash(name, seed_) & (slots_.size() - 1)];
+    if (slot == 0 || names_[slot - 1] != name) {
+      return nullptr;
+    }
+
+    return &handlers_[slot - 1];
+  }
+
+  size_t Size() const noexcept { return handlers_.size(); }
+
+ private:
+  constexpr static uint64_t kSeedsPerSize = 64;
+
+  static uint64_t Hash(std::string_view name, uint64_t seed) noexcept {
+    // FNV-1a
+    uint64_t hash = 14'695'981'039'346'656'037ull ^ seed;
+    for (char c : name) {
+      hash ^= static_cast<unsigned char>(c);
+      hash *= 1'099'511'628'211ull;
+    }
+    return hash ^ (hash >> 32);
+  }
+
+  // Looks for a seed without collisions, growing the table if it takes too
+  // long. Runs on registration only.
+  void Rebuild() {
+    size_t size = 1;
+    while (size < names_.size() * 2) {
+      size *= 2;
+    }
+
+    std::vector<uint32_t> slots;
+    for (;; size *= 2) {
+      for (uint64_t seed = 0; seed < kSeedsPerSize; ++seed) {
+        slots.assign(size, 0);
+
+        bool is_perfect = true;
+        for (size_t i = 0; i < names_.size() && is_perfect; ++i) {
+          uint32_t& slot = slots[Hash(names_[i], seed) & (size - 1)];
+          is_perfect = slot == 0;
+          slot = static_cast<uint32_t>(i + 1);
+        }
+
+        if (is_perfect) {
+          slots_ = std::move(slots);
+          seed_ = seed;
+          return;
+        }
+      }
+    }
+  }
+
+  std::vector<std::string> names_;
+  std::vector<Handler> handlers_;
+  // index of the handler plus one, 0 for empty slots
+  std::vector<uint32_t> slots_;
+  uint64_t seed_;
+};
+
+#endif  // CPP_LINUX_SOCKETS_APP_INCLUDE_COMMAND_ROUTER_H_
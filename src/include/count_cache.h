@@ -0,0 +1,76 @@
+#ifndef CPP_LINUX_SOCKETS_APP_INCLUDE_COUNT_CACHE_H_
+#define CPP_LINUX_SOCKETS_APP_INCLUDE_COUNT_CACHE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// Count tables of recently counted messages. Messages are looked up by their
+// CRC32C and then compared whole, so a collision is a miss rather than a
+// wrong table. Once the entries take more than the capacity the least
+// recently used ones are evicted. Safe to use from several threads.
+class CountCache {
+ public:
+  struct Stats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    size_t entries = 0;
+    // messages and tables of the entries
+    size_t bytes = 0;
+  };
+
+  // capacity is in bytes, 0 disables the cache.
+  explicit CountCache(size_t capacity);
+
+  CountCache(const CountCache&) = delete;
+  CountCache& operator=(const CountCache&) = delete;
+
+  // CRC32C with the SSE4.2 instruction if the CPU has it, the entries are
+  // looked up by it.
+  static uint32_t Hash(std::string_view message) noexcept;
+
+  bool IsEnabled() const noexcept;
+
+  // Table of the message, shared with the cache, or null if it isn't cached.
+  // Counts a hit or a miss.
+  std::shared_ptr<const std::string> Find(uint32_t hash,
+                                          std::string_view message);
+  // Replaces an entry of another message with the same hash. Entries larger
+  // than a quarter of the capacity aren't cached.
+  void Insert(uint32_t hash, std::string_view message,
+              std::shared_ptr<const std::string> table);
+
+  Stats GetStats() const;
+
+ private:
+  struct Entry {
+    uint32_t hash;
+    std::string message;
+    std::shared_ptr<const std::string> table;
+
+    size_t GetSize() const noexcept;
+  };
+
+  // most recently used first
+  using Entries = std::list<std::shared_ptr<const Entry>>;
+
+  void Erase(Entries::iterator entry);
+
+  const size_t capacity_;
+
+  std::atomic<uint64_t> hits_;
+  std::atomic<uint64_t> misses_;
+
+  mutable std::mutex mutex_;
+  Entries entries_;
+  std::unordered_map<uint32_t, Entries::iterator> entries_by_hash_;
+  size_t bytes_;
+};
+
+#endif  // CPP_LINUX_SOCKETS_APP_INCLUDE_COUNT_CACHE_H_
@@ -0,0 +1,15 @@
+#ifndef CPP_LINUX_SOCKETS_APP_INCLUDE_COUNT_TABLE_H_
+#define CPP_LINUX_SOCKETS_APP_INCLUDE_COUNT_TABLE_H_
+
+#include <string>
+#include <string_view>
+
+#include "include/letter_counter.h"
+
+// Pretty-print table of the count command: the message followed by letters
+// with their counts. The size of the table is computed before it's written,
+// so it takes a single allocation.
+std::string FormatCountTable(std::string_view message,
+                             const LetterCounter::Counts& counts);
+
+#endif  // CPP_LINUX_SOCKETS_APP_INCLUDE_COUNT_TABLE_H_
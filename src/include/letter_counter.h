@@ -0,0 +1,65 @@
+#ifndef CPP_LINUX_SOCKETS_APP_INCLUDE_LETTER_COUNTER_H_
+#define CPP_LINUX_SOCKETS_APP_INCLUDE_LETTER_COUNTER_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Counts letters of a text with a flat histogram. Very large texts are split
+// between several threads.
+class LetterCounter {
+ public:
+  // Vector kernels compare every chunk of the text with each of 52 letters,
+  // which doesn't beat the table lookups of the scalar kernel on the CPUs we
+  // measured, so kAuto picks the scalar one. They are checked against the
+  // CPU at runtime and may be picked explicitly, see count_bench.
+  enum class Kernel { kAuto, kScalar, kSse2, kAvx2 };
+
+  using Histogram = std::array<uint64_t, 256>;
+  using Counts = std::vector<std::pair<char, size_t>>;
+
+  // Counts of a text which is received in pieces, letters keep the order of
+  // their first occurrence across all of the pieces.
+  class Tally {
+   public:
+    Tally();
+
+    void Add(const LetterCounter& counter, std::string_view piece);
+
+    Counts GetCounts() const;
+    // Total size of the pieces.
+    size_t GetTextSize() const noexcept;
+
+   private:
+    Histogram histogram_;
+    // letters in the order of their first occurrence
+    std::vector<char> letters_;
+    size_t text_size_;
+  };
+
+  // texts shorter than this are counted by the calling thread only
+  constexpr static size_t kMinParallelSize = 4 * 1'024 * 1'024;
+
+  // threads_count of 0 means one per core.
+  explicit LetterCounter(Kernel kernel = Kernel::kAuto,
+                         size_t threads_count = 0);
+
+  static bool IsSupported(Kernel kernel) noexcept;
+
+  // Letters with their counts in the order of their first occurrence.
+  Counts Count(std::string_view text) const;
+
+  // Counts of letter bytes, other bytes are left zero.
+  Histogram CountLetters(std::string_view text) const;
+
+  Kernel GetKernel() const noexcept;
+
+ private:
+  Kernel kernel_;
+  size_t threads_count_;
+};
+
+#endif  // CPP_LINUX_SOCKETS_APP_INCLUDE_LETTER_COUNTER_H_
@@ -2,6 +2,8 @@
 #define CPP_LINUX_SOCKETS_APP_INCLUDE_NET_ADDRESS_H_
 
 #include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 
 #include <stdexcept>
 #include <string>
@@ -24,20 +26,38 @@ class Address {
  public:
   static Address FromString(const std::string& address,
                             AddressFamilyType address_family = AF_INET);
+  // Unix domain socket address. A path starting with '@' is abstract, the
+  // '@' stands for the zero byte and no file is created for it. Throws
+  // AddressError if the path doesn't fit into sockaddr_un.
+  static Address FromPath(const std::string& path);
 
   Address(const std::string& ip, unsigned port,
           AddressFamilyType address_family = AF_INET);
 
   virtual ~Address() = default;
 
+  // Both are 0 for Unix domain socket addresses.
   AddressType GetAddress() const noexcept;
   PortType GetPort() const noexcept;
   AddressFamilyType GetAddressFamily() const noexcept;
+  // Empty for IP addresses, abstract paths start with '@'.
+  std::string GetPath() const;
 
+  // Of IP addresses only.
   struct sockaddr_in GetAddressInfo() const noexcept;
 
+  // Address of any family as taken by bind and connect.
+  const struct sockaddr* GetSockAddr() const noexcept;
+  socklen_t GetSockAddrLength() const noexcept;
+
  private:
-  struct sockaddr_in address_info_;
+  Address() noexcept;
+
+  union {
+    struct sockaddr_in address_info_;
+    struct sockaddr_un path_info_;
+  };
+  socklen_t address_info_length_;
 };
 
 }  // namespace net
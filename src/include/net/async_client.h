@@ -0,0 +1,130 @@
+#ifndef CPP_LINUX_SOCKETS_APP_INCLUDE_NET_ASYNC_CLIENT_H_
+#define CPP_LINUX_SOCKETS_APP_INCLUDE_NET_ASYNC_CLIENT_H_
+
+#include <sys/socket.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+#include "include/net/address.h"
+#include "include/net/frame.h"
+#include "include/net/outbound_queue.h"
+#include "include/net/poller.h"
+#include "include/net/socket.h"
+
+namespace net {
+
+// Client keeping any number of requests in flight on a single connection.
+// Binary framing is always negotiated and responses are matched to their
+// requests by the request id echoed by the server, so requests are written
+// back to back without waiting for the responses of the previous ones.
+// Messages carrying zero request id, e.g. broadcasts of other clients, and
+// replies to sends are pushed to the subscriber instead.
+//
+// Reading, and writing whatever the socket doesn't take at once, is done by
+// a background thread, which also runs every callback. Callbacks must not
+// block, they hold up the responses behind them. Signals are never delivered
+// to the background thread.
+class AsyncClient {
+ public:
+  // kOk with the response, kClosed with an empty one if the connection was
+  // lost or closed before the response arrived.
+  using ResponseCallback = std::function<void(Status, std::string)>;
+  using PushCallback =
+      std::function<void(const std::string&, const FrameHeader&)>;
+
+  explicit AsyncClient(AddressFamilyType address_family = AF_INET,
+                       SocketType socket_type = SOCK_STREAM,
+                       ProtocolType protocol = 0,
+                       PollerType poller_type = PollerType::kEpoll);
+
+  AsyncClient(const AsyncClient&) = delete;
+  AsyncClient& operator=(const AsyncClient&) = delete;
+
+  ~AsyncClient();
+
+  // Negotiates binary framing and starts the background thread. Throws
+  // ClientError if the server doesn't support binary framing or the client
+  // is closed, a closed client can't be connected again.
+  void Connect(const Address& address,
+               int timeout_msec = Socket::kDefaultTimeoutMsec);
+  // Stops the background thread, failing pending requests with kClosed. Must
+  // not be called from a callback.
+  void Close();
+
+  // Replaces the subscriber, the previous one isn't called once this
+  // returns. Must not be called from the subscriber itself.
+  void Subscribe(PushCallback callback);
+
+  // All of these queue the message without blocking and may be called from
+  // any thread, callbacks included. They throw ClientError once the
+  // connection is closed.
+  //
+  // The callback is called once with the response.
+  void Request(const std::string& message, ResponseCallback callback,
+               uint16_t command_id = 0, uint16_t flags = 0);
+  // The future throws ClientError if the connection is lost.
+  std::future<std::string> Request(const std::string& message,
+                                   uint16_t command_id = 0);
+  // For messages which get no response, e.g. broadcasts. They carry request
+  // ids of their own as well, so a reply the server sends anyway, e.g. an
+  // error, is pushed to the subscriber with a nonzero request id rather than
+  // taken for the response of a request.
+  void Send(const std::string& message, uint16_t command_id = 0,
+            uint16_t flags = 0);
+
+  // Requests waiting for their responses.
+  size_t GetPendingCount() const;
+
+  bool IsConnected() const noexcept;
+
+ private:
+  // Request ids of sends have it set, the ones of requests don't, so a reply
+  // to a send is never taken for the response of a request.
+  constexpr static uint32_t kSendRequestIdBit = 0x8000'0000;
+
+  // Skips zero and ids of requests still waiting for their responses, which
+  // may be left when the ids wrap around. Called with the mutex held.
+  uint32_t MakeRequestId();
+  // Frames and queues the message with the mutex held.
+  void Enqueue(const std::string& message, const FrameHeader& header);
+
+  void RunIo();
+  // Returns false once the connection is closed.
+  bool ReceiveResponses();
+  bool FlushOutbound();
+
+  Socket socket_;
+  PollerType poller_type_;
+  std::unique_ptr<Poller> poller_;
+
+  std::atomic<bool> is_closing_;
+
+  // guards everything below as well as writing to the socket
+  mutable std::mutex mutex_;
+  bool is_connected_;
+  uint32_t next_request_id_;
+  uint32_t next_send_id_;
+  std::unordered_map<uint32_t, ResponseCallback> pending_;
+  OutboundQueue outbound_;
+  // set by senders, the background thread starts waiting for writability
+  bool is_write_requested_;
+
+  // held while the subscriber runs
+  std::mutex push_mutex_;
+  PushCallback push_callback_;
+
+  std::thread io_thread_;
+};
+
+}  // namespace net
+
+#endif  // CPP_LINUX_SOCKETS_APP_INCLUDE_NET_ASYNC_CLIENT_H_
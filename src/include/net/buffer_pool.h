@@ -0,0 +1,46 @@
+#ifndef CPP_LINUX_SOCKETS_APP_INCLUDE_NET_BUFFER_POOL_H_
+#define CPP_LINUX_SOCKETS_APP_INCLUDE_NET_BUFFER_POOL_H_
+
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace net {
+
+// Free lists of message buffers by power of two size classes. Buffers are
+// acquired by the event loop and released by workers, so once the pool is
+// warm receiving a message doesn't allocate. Buffers outside of the classes
+// are neither pooled nor kept.
+class BufferPool {
+ public:
+  constexpr static size_t kMinBufferSize = 64;
+  constexpr static size_t kMaxBufferSize = 64 * 1'024;
+  constexpr static size_t kMaxBuffersPerClass = 1'024;
+
+  BufferPool();
+
+  BufferPool(const BufferPool&) = delete;
+  BufferPool& operator=(const BufferPool&) = delete;
+
+  // Returns an empty buffer with capacity of at least size bytes.
+  std::string Acquire(size_t size);
+  void Release(std::string buffer);
+  // Releases all of the buffers at once and clears the vector.
+  void Release(std::vector<std::string>& buffers);
+
+ private:
+  // Returns the class of buffers with capacity of at least size bytes.
+  static size_t GetAcquireClass(size_t size) noexcept;
+  // Returns the class of buffers which the capacity is enough for.
+  static size_t GetReleaseClass(size_t capacity) noexcept;
+
+  void ReleaseLocked(std::string& buffer);
+
+  std::mutex mutex_;
+  std::vector<std::vector<std::string>> free_lists_;
+};
+
+}  // namespace net
+
+#endif  // CPP_LINUX_SOCKETS_APP_INCLUDE_NET_BUFFER_POOL_H_
@@ -7,6 +7,7 @@
 #include <string>
 
 #include "include/net/address.h"
+#include "include/net/frame.h"
 #include "include/net/socket.h"
 
 namespace net {
@@ -22,11 +23,19 @@ class Client {
                   SocketType socket_type = SOCK_STREAM,
                   ProtocolType protocol = 0);
 
-  void Connect(const Address& address);
+  // Binary framing is negotiated right after connecting, servers which don't
+  // support it close the connection, ClientError is thrown then.
+  void Connect(const Address& address, Framing framing = Framing::kText);
 
   Status Send(const std::string& message,
               int timeout_msec = Socket::kDefaultTimeoutMsec);
+  Status Send(const std::string& message, const FrameHeader& header,
+              int timeout_msec = Socket::kDefaultTimeoutMsec);
   Response<std::string> Receive(int timeout_msec = Socket::kDefaultTimeoutMsec);
+  Status Receive(std::string& message, FrameHeader& header,
+                 int timeout_msec = Socket::kDefaultTimeoutMsec);
+
+  Framing GetFraming() const noexcept;
 
   bool IsConnected() const noexcept;
 
@@ -0,0 +1,54 @@
+#ifndef CPP_LINUX_SOCKETS_APP_INCLUDE_NET_FRAME_H_
+#define CPP_LINUX_SOCKETS_APP_INCLUDE_NET_FRAME_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace net {
+
+// Wire format of the messages of a connection. Text frames are a decimal
+// length followed by ';', binary ones have a fixed-size header with metadata.
+// Connections start with text framing, binary framing is negotiated by a
+// handshake right after connecting.
+enum class Framing { kText, kBinary };
+
+// Metadata carried by binary frames along with their length, text frames
+// carry none of it. Responses of the server echo the request id and the
+// command id of their requests.
+struct FrameHeader {
+  uint32_t request_id = 0;
+  uint16_t command_id = 0;
+  uint16_t flags = 0;
+};
+
+// Part of a message popped by streaming receive. Messages which fit into a
+// single chunk are popped whole, with zero offset and message size equal to
+// the size of the chunk.
+struct MessageChunk {
+  FrameHeader header;
+  size_t message_size = 0;
+  // of the chunk within the message
+  size_t offset = 0;
+};
+
+// Flags reserved by the protocol, the rest of the bits are free for
+// applications. Payloads are passed as they are, the protocol doesn't
+// compress or reorder them by itself.
+constexpr uint16_t kFrameCompressed = 1 << 0;
+constexpr uint16_t kFramePriorityMask = 0b11 << 1;
+constexpr uint16_t kFramePriorityShift = 1;
+
+// Binary header: length, request id, command id and flags, all of them
+// little-endian.
+constexpr size_t kBinaryHeaderSize = 12;
+
+// Handshake offering binary framing: a zero byte, "FRM" and the highest
+// version the connecting side supports, little-endian. The accepting side
+// replies the same way with the version both of them will use. Text headers
+// start with a digit, which tells old clients apart from the zero byte.
+constexpr size_t kHandshakeSize = 6;
+constexpr uint16_t kProtocolVersion = 1;
+
+}  // namespace net
+
+#endif  // CPP_LINUX_SOCKETS_APP_INCLUDE_NET_FRAME_H_
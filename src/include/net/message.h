@@ -0,0 +1,39 @@
+#ifndef CPP_LINUX_SOCKETS_APP_INCLUDE_NET_MESSAGE_H_
+#define CPP_LINUX_SOCKETS_APP_INCLUDE_NET_MESSAGE_H_
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace net {
+
+// Message made of one or more parts, which are sent back to back as a single
+// frame without being joined. Converts implicitly from strings, so response
+// processors may keep returning them. Parts are shared rather than copied, so
+// the same string, e.g. a cached one, may be a part of many messages.
+class Message {
+ public:
+  using Part = std::shared_ptr<const std::string>;
+
+  Message() = default;
+  Message(const char* data);
+  Message(std::string data);
+  Message(std::vector<std::string> parts);
+  Message(Part part);
+  Message(std::vector<Part> parts);
+
+  bool Empty() const noexcept;
+  // Total size of all of the parts.
+  size_t Size() const noexcept;
+
+  const std::vector<Part>& GetParts() const noexcept;
+  std::vector<Part> TakeParts() noexcept;
+
+ private:
+  std::vector<Part> parts_;
+};
+
+}  // namespace net
+
+#endif  // CPP_LINUX_SOCKETS_APP_INCLUDE_NET_MESSAGE_H_
@@ -0,0 +1,55 @@
+#ifndef CPP_LINUX_SOCKETS_APP_INCLUDE_NET_OUTBOUND_QUEUE_H_
+#define CPP_LINUX_SOCKETS_APP_INCLUDE_NET_OUTBOUND_QUEUE_H_
+
+#include <sys/uio.h>
+
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "include/net/socket.h"
+
+namespace net {
+
+// Framed messages waiting to be written to a connection. Buffers are shared
+// and immutable, so the same buffer may be queued to any number of sockets.
+class OutboundQueue {
+ public:
+  constexpr static size_t kMaxBuffersPerWrite = 64;
+
+  OutboundQueue();
+
+  void Push(std::shared_ptr<const std::string> data);
+
+  // Number of bytes not written yet.
+  size_t Size() const noexcept;
+  bool Empty() const noexcept;
+
+  // Writes as much as the socket accepts without blocking, gathering queued
+  // chunks into vectored writes. Returns kOk once
+  // the queue is empty, kTimeout if the socket can't take more right now and
+  // kClosed if the peer is gone.
+  Status Flush(Socket& socket);
+
+  // Buffers of up to kMaxBuffersPerWrite chunks from the front, for writes
+  // made elsewhere, e.g. by the poller. Owners of the chunks are appended,
+  // so the memory outlives a write which completes after the chunks are
+  // consumed. Returns the number of buffers.
+  size_t Gather(struct iovec* buffers,
+                std::vector<std::shared_ptr<const std::string>>& owners) const;
+  // Drops written bytes from the front.
+  void Consume(size_t size) noexcept;
+
+ private:
+  size_t GatherBuffers(struct iovec* buffers) const noexcept;
+
+  std::deque<std::shared_ptr<const std::string>> chunks_;
+  size_t front_offset_;
+  size_t size_;
+};
+
+}  // namespace net
+
+#endif  // CPP_LINUX_SOCKETS_APP_INCLUDE_NET_OUTBOUND_QUEUE_H_
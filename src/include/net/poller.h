@@ -0,0 +1,255 @@
+#ifndef CPP_LINUX_SOCKETS_APP_INCLUDE_NET_POLLER_H_
+#define CPP_LINUX_SOCKETS_APP_INCLUDE_NET_POLLER_H_
+
+#include <linux/io_uring.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "include/net/socket.h"
+
+namespace net {
+
+class PollerError : public std::runtime_error {
+ public:
+  explicit PollerError(const std::string& message);
+};
+
+// kUring falls back to kEpoll if the kernel doesn't support io_uring
+enum class PollerType { kPoll, kEpoll, kUring };
+
+// Backends doing the I/O themselves report its results instead of readiness:
+// a listener is readable with a descriptor accepted from it, a connection is
+// readable with the bytes received from it or writable with the number of
+// bytes it took from a send.
+struct PollEvent {
+  FileDescriptorType file_descriptor;
+  bool is_readable;
+  bool is_writable;
+  bool is_closed;
+
+  FileDescriptorType accepted = -1;
+  // valid until the next Wait
+  std::string_view received = {};
+  size_t sent = 0;
+};
+
+// Readiness notification backend used by the server event loop. Descriptors
+// are registered once and stay registered until they are removed, so the
+// backend can keep its own kernel or user space state between waits.
+//
+// Backends which do the I/O themselves may also take over accepting,
+// receiving and sending, so none of them costs a system call of its own:
+// operations are queued and submitted together with the next wait.
+class Poller {
+ public:
+  static std::unique_ptr<Poller> Create(PollerType type);
+
+  Poller();
+
+  Poller(const Poller&) = delete;
+  Poller& operator=(const Poller&) = delete;
+
+  virtual ~Poller();
+
+  // Descriptors are added with read interest only.
+  virtual void Add(FileDescriptorType file_descriptor) = 0;
+  virtual void Remove(FileDescriptorType file_descriptor) = 0;
+  virtual void SetWritable(FileDescriptorType file_descriptor,
+                           bool is_writable) = 0;
+
+  // Fills events with ready descriptors only, returns their count.
+  virtual size_t Wait(std::vector<PollEvent>& events, int timeout_msec) = 0;
+
+  // Whether the descriptors may be added with AddListener and AddConnection,
+  // the rest of the methods below throw PollerError otherwise.
+  virtual bool IsDoingIo() const noexcept;
+  // Connections are accepted from the listener without waiting for its
+  // readiness.
+  virtual void AddListener(FileDescriptorType file_descriptor);
+  // Bytes are received from the connection as soon as they arrive, until
+  // receiving is paused.
+  virtual void AddConnection(FileDescriptorType file_descriptor);
+  // Pausing leaves the bytes in the socket, e.g. while the ones received
+  // before aren't processed, so a fast peer is held back by TCP flow control.
+  virtual void SetReceiving(FileDescriptorType file_descriptor,
+                            bool is_receiving);
+  // Only one send of a connection may be in flight. Owners keep the memory of
+  // the buffers alive until the send completes, even if the connection is
+  // removed meanwhile.
+  virtual void Send(FileDescriptorType file_descriptor,
+                    const struct iovec* buffers, size_t count,
+                    std::vector<std::shared_ptr<const std::string>> owners);
+
+  // Interrupts a Wait running in another thread. Safe to call from any
+  // thread, the interrupted Wait may return with no events.
+  void Wakeup() noexcept;
+
+ protected:
+  // Returns true if the descriptor is the wakeup one, draining it.
+  bool ConsumeWakeup(FileDescriptorType file_descriptor) noexcept;
+
+  FileDescriptorType wakeup_file_descriptor_;
+};
+
+class PollPoller final : public Poller {
+ public:
+  PollPoller();
+
+  void Add(FileDescriptorType file_descriptor) override;
+  void Remove(FileDescriptorType file_descriptor) override;
+  void SetWritable(FileDescriptorType file_descriptor,
+                   bool is_writable) override;
+
+  size_t Wait(std::vector<PollEvent>& events, int timeout_msec) override;
+
+ private:
+  std::vector<struct pollfd> descriptors_;
+  std::unordered_map<FileDescriptorType, size_t> indices_;
+};
+
+class EpollPoller final : public Poller {
+ public:
+  constexpr static int kMaxEventsPerWait = 256;
+
+  EpollPoller();
+
+  ~EpollPoller() override;
+
+  void Add(FileDescriptorType file_descriptor) override;
+  void Remove(FileDescriptorType file_descriptor) override;
+  void SetWritable(FileDescriptorType file_descriptor,
+                   bool is_writable) override;
+
+  size_t Wait(std::vector<PollEvent>& events, int timeout_msec) override;
+
+ private:
+  FileDescriptorType epoll_file_descriptor_;
+  std::vector<struct epoll_event> ready_;
+};
+
+// Readiness is requested with one-shot io_uring poll submissions. They are
+// queued in the submission ring and re-armed after every completion, then
+// submitted together with the wait by a single io_uring_enter per Wait.
+//
+// If the kernel supports provided buffers, it does the I/O as well: listeners
+// get one-shot accepts and connections get one-shot receives into buffers
+// provided to the ring, both re-armed the same way as polls, and sends are
+// submitted as they are requested. Received bytes are handed over right from
+// the provided buffers, which go back to the kernel on the next Wait.
+class UringPoller final : public Poller {
+ public:
+  constexpr static unsigned kRingEntries = 1'024;
+  constexpr static unsigned kReceiveBuffersCount = 256;
+  constexpr static size_t kReceiveBufferSize = 16 * 1'024;
+
+  UringPoller();
+
+  ~UringPoller() override;
+
+  void Add(FileDescriptorType file_descriptor) override;
+  void Remove(FileDescriptorType file_descriptor) override;
+  void SetWritable(FileDescriptorType file_descriptor,
+                   bool is_writable) override;
+
+  size_t Wait(std::vector<PollEvent>& events, int timeout_msec) override;
+
+  bool IsDoingIo() const noexcept override;
+  void AddListener(FileDescriptorType file_descriptor) override;
+  void AddConnection(FileDescriptorType file_descriptor) override;
+  void SetReceiving(FileDescriptorType file_descriptor,
+                    bool is_receiving) override;
+  void Send(FileDescriptorType file_descriptor, const struct iovec* buffers,
+            size_t count,
+            std::vector<std::shared_ptr<const std::string>> owners) override;
+
+ private:
+  // what is submitted for the descriptor besides sends
+  enum class Operation : uint32_t { kPoll, kAccept, kReceive };
+
+  struct Registration {
+    uint32_t generation;
+    Operation operation;
+    bool is_writable;
+    bool is_receiving;
+    bool is_armed;
+    bool is_sending;
+  };
+
+  // kept until the send completes, the kernel reads the message when the
+  // submission is consumed and the buffers until it completes
+  struct PendingSend {
+    struct msghdr message;
+    std::vector<struct iovec> buffers;
+    std::vector<std::shared_ptr<const std::string>> owners;
+  };
+
+  // completions of submissions which aren't tracked are tagged with this
+  constexpr static uint64_t kIgnoredUserData = ~uint64_t(0);
+  constexpr static uint16_t kReceiveBufferGroup = 0;
+
+  // generations wrap around in the upper 31 bits of the upper half, the
+  // lowest bit of it tells sends from the other submissions
+  static uint64_t MakeUserData(FileDescriptorType file_descriptor,
+                               uint32_t generation, bool is_send) noexcept;
+
+  Registration& Register(FileDescriptorType file_descriptor,
+                         Operation operation);
+  Registration& Find(FileDescriptorType file_descriptor);
+
+  void Release() noexcept;
+  // Returns false if the kernel doesn't support provided buffers.
+  bool SetUpReceiveBuffers();
+  // Consecutive buffers starting from first_id.
+  void ProvideReceiveBuffers(uint16_t first_id, uint16_t count);
+
+  struct io_uring_sqe* GetSubmissionEntry();
+  void Arm(FileDescriptorType file_descriptor, Registration& registration);
+  void SubmitCancel(uint64_t user_data);
+  int Enter(unsigned min_complete, int timeout_msec);
+
+  FileDescriptorType ring_file_descriptor_;
+
+  void* rings_;
+  size_t rings_size_;
+  struct io_uring_sqe* submission_entries_;
+  size_t submission_entries_size_;
+
+  unsigned* submission_head_;
+  unsigned* submission_tail_;
+  // entries are published to the kernel right before entering
+  unsigned local_submission_tail_;
+  unsigned submission_mask_;
+  unsigned submission_entries_count_;
+  unsigned* submission_array_;
+
+  unsigned* completion_head_;
+  unsigned* completion_tail_;
+  unsigned completion_mask_;
+  struct io_uring_cqe* completion_entries_;
+
+  // provided to the kernel, which picks one for every receive; nullptr if it
+  // doesn't support them
+  char* receive_buffers_;
+  // handed over by the previous Wait
+  std::vector<uint16_t> used_receive_buffers_;
+
+  uint32_t next_generation_;
+  std::unordered_map<FileDescriptorType, Registration> registrations_;
+  std::vector<FileDescriptorType> disarmed_;
+  std::unordered_map<uint64_t, PendingSend> sends_;
+};
+
+}  // namespace net
+
+#endif  // CPP_LINUX_SOCKETS_APP_INCLUDE_NET_POLLER_H_
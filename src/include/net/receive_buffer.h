@@ -0,0 +1,41 @@
+#ifndef CPP_LINUX_SOCKETS_APP_INCLUDE_NET_RECEIVE_BUFFER_H_
+#define CPP_LINUX_SOCKETS_APP_INCLUDE_NET_RECEIVE_BUFFER_H_
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+namespace net {
+
+// Per-connection buffer of received but not yet parsed bytes. Reading side
+// consumes from the front, writing side appends to the back; unread bytes are
+// moved to the front only when the tail runs out of space, so frames are
+// always parsed from contiguous memory.
+class ReceiveBuffer {
+ public:
+  constexpr static size_t kDefaultCapacity = 16 * 1'024;
+
+  explicit ReceiveBuffer(size_t capacity = kDefaultCapacity);
+
+  std::string_view Data() const noexcept;
+  size_t Size() const noexcept;
+  bool Empty() const noexcept;
+
+  void Consume(size_t size) noexcept;
+
+  // Returns writable tail of at least min_size bytes, growing when needed.
+  char* PrepareWrite(size_t min_size);
+  size_t WritableSize() const noexcept;
+  void Commit(size_t size) noexcept;
+
+ private:
+  size_t initial_capacity_;
+
+  std::vector<char> buffer_;
+  size_t begin_;
+  size_t end_;
+};
+
+}  // namespace net
+
+#endif  // CPP_LINUX_SOCKETS_APP_INCLUDE_NET_RECEIVE_BUFFER_H_
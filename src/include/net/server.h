@@ -3,14 +3,31 @@
 
 #include <sys/socket.h>
 
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <memory>
+#include <mutex>
+#include <shared_mutex>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include "include/net/address.h"
+#include "include/net/buffer_pool.h"
+#include "include/net/frame.h"
+#include "include/net/message.h"
+#include "include/net/outbound_queue.h"
+#include "include/net/poller.h"
+#include "include/net/slot_map.h"
 #include "include/net/socket.h"
+#include "include/net/stats.h"
+#include "include/net/thread_pool.h"
+#include "include/net/timer_wheel.h"
 
 namespace net {
 
@@ -19,31 +36,377 @@ class ServerError : public std::runtime_error {
   explicit ServerError(const std::string& message);
 };
 
+enum class OverflowPolicy { kDisconnect, kDrop };
+
+// kInfo logs a summary at most once per log interval, kDebug also logs every
+// accepted and closed connection.
+enum class LogLevel { kSilent, kInfo, kDebug };
+
+struct ServerOptions {
+  PollerType poller_type = PollerType::kEpoll;
+
+  // number of event loops, each with its own listener bound to the same port
+  // with SO_REUSEPORT and its own set of connections; 0 means one per core.
+  // Unix domain sockets can't share a path that way, all of the event loops
+  // accept from the same listener then
+  size_t reactors_count = 0;
+
+  // requests are processed by a fixed pool of workers fed through a bounded
+  // queue; event loops block on submission only while the queue is full
+  size_t workers_count = 0;  // 0 means one per core
+  size_t tasks_queue_capacity = 1'024;
+
+  // maximum number of requests taken from one connection per event loop
+  // iteration, so a pipelining client can't starve the others; 0 means
+  // unlimited
+  size_t max_requests_per_wakeup = 64;
+
+  // requests longer than this close their connection as soon as their header
+  // is received, unless they are streamed
+  size_t max_message_size = 16 * 1'024 * 1'024;
+  // requests longer than this are handed to ProcessRequestChunk in chunks of
+  // this size as soon as each of them is received, instead of being buffered
+  // whole; 0 disables streaming
+  size_t streaming_threshold = 0;
+  // streamed requests longer than this close their connection as soon as
+  // their header is received
+  size_t max_streamed_message_size = 1'024 * 1'024 * 1'024;
+
+  // responses are queued per connection and written without blocking; once
+  // more than high watermark bytes are pending the overflow policy applies
+  // until the queue drains below low watermark
+  size_t outbound_high_watermark = 4 * 1'024 * 1'024;
+  size_t outbound_low_watermark = 1'024 * 1'024;
+  OverflowPolicy overflow_policy = OverflowPolicy::kDisconnect;
+
+  // connections are closed once any of these runs out, 0 disables a timeout;
+  // deadlines are kept in a timer wheel of every event loop, so connections
+  // are never scanned for them
+  // without a request, or a chunk of one, received
+  int idle_timeout_msec = 0;
+  // from the first byte of a message to the end of its header and from the
+  // end of the header to the end of the message, or of every chunk of a
+  // streamed one; neither starts over when a part of them arrives, so a peer
+  // trickling bytes can't hold a connection forever
+  int header_timeout_msec = 0;
+  int body_timeout_msec = 0;
+  // with responses pending and none of their bytes taken by the socket
+  int write_stall_timeout_msec = 0;
+
+  // logs go to stderr
+  LogLevel log_level = LogLevel::kInfo;
+  int log_interval_msec = 10'000;
+};
+
 class Server {
  public:
+  // Returned message may consist of several parts, e.g. header, rows and
+  // footer of a table, which are sent as one frame without being joined.
   using ResponseProcessor =
-      std::function<std::string(std::shared_ptr<Socket>, const std::string&)>;
+      std::function<Message(std::shared_ptr<Socket>, const std::string&)>;
+  using ConnectionVisitor = std::function<void(const std::shared_ptr<Socket>&)>;
+  // Numeric id of a connection, assigned once it's accepted. It stays the
+  // same while the connection is open and isn't given to any other
+  // connection of the same Serve call afterwards; never 0.
+  using ConnectionId = uint64_t;
 
   explicit Server(AddressFamilyType listener_address_family = AF_INET,
                   SocketType listener_socket_type = SOCK_STREAM,
                   ProtocolType listener_protocol = 0);
+  explicit Server(const ServerOptions& options,
+                  AddressFamilyType listener_address_family = AF_INET,
+                  SocketType listener_socket_type = SOCK_STREAM,
+                  ProtocolType listener_protocol = 0);
 
-  virtual ~Server() = default;
+  virtual ~Server();
 
+  // Runs the first event loop in the calling thread and the rest of them in
+  // their own threads. Returns after Stop or throws on the first error of any
+  // event loop.
   void Serve(const Address& address,
              const ResponseProcessor& response_processor,
              int timeout_msec = 60'000);
+  // Listens on all of the addresses at once, e.g. on a TCP port for remote
+  // clients and a Unix domain socket for the ones on the same host. Socket
+  // files of Unix domain addresses left by a previous run are replaced, and
+  // removed once serving ends; a file another server listens on throws
+  // ServerError instead.
+  void Serve(const std::vector<Address>& addresses,
+             const ResponseProcessor& response_processor,
+             int timeout_msec = 60'000);
+  // Async-signal-safe, so it may be called from a signal handler. Once Serve
+  // is called, a Stop which comes before its event loops start isn't lost,
+  // they return right away.
+  void Stop() noexcept;
 
   bool IsServing() const noexcept;
 
+  // Both are global across all event loops and may be called from any of
+  // them, including from inside of the response processor.
+  size_t GetConnectionsCount() const;
+  void ForEachConnection(const ConnectionVisitor& visitor) const;
+  // Throws ServerError if the socket isn't a connection of this server.
+  ConnectionId GetConnectionId(const std::shared_ptr<Socket>& connection) const;
+  // Looks the connection up in O(1), returns nullptr if it's closed or has
+  // never existed. May be called from any thread while serving.
+  std::shared_ptr<Socket> GetConnection(ConnectionId id) const;
+  // Totals since the server was created, may be called from any thread at
+  // any time. Counters are read one by one without stopping the event loops,
+  // so they aren't a consistent snapshot.
+  ServerStats GetStats() const;
+
+  // Queues the message to the connection of this server without blocking and
+  // may be called from any thread. Returns kDropped or kClosed if the message
+  // was discarded by the overflow policy. The header goes along with binary
+  // frames only.
+  Status Send(const std::shared_ptr<Socket>& connection, Message message,
+              const FrameHeader& header = FrameHeader());
+  // Frames the message once per framing and queues the same buffers to every
+  // connection except the given one. Returns the number of connections it
+  // was queued to.
+  size_t Broadcast(Message message,
+                   const std::shared_ptr<Socket>& except = nullptr);
+
+  // Topics are independent channels on one server: messages published to a
+  // topic are queued to its subscribers only, at a cost proportional to
+  // their number. Subscriptions of a connection are dropped once it's
+  // closed. All of them may be called from any thread.
+  //
+  // Returns kClosed if the connection is closed already.
+  Status Subscribe(const std::shared_ptr<Socket>& connection,
+                   const std::string& topic);
+  // Returns false if the connection isn't subscribed to the topic.
+  bool Unsubscribe(const std::shared_ptr<Socket>& connection,
+                   const std::string& topic);
+  // Frames the message once per framing like Broadcast does. Returns the
+  // number of subscribers it was queued to.
+  size_t Publish(const std::string& topic, Message message);
+
  protected:
-  virtual void ProcessConnection(std::shared_ptr<Socket> connection,
-                                 const ResponseProcessor& response_processor);
+  // Runs on a worker thread. Requests of the same connection are processed
+  // one at a time in the order they were received. Header is the metadata of
+  // a binary frame, the default one for text frames.
+  virtual void ProcessRequest(std::shared_ptr<Socket> connection,
+                              const std::string& request,
+                              const FrameHeader& header,
+                              const ResponseProcessor& response_processor);
+  // Runs on a worker thread for every chunk of a streamed request, in order
+  // with the other requests of the connection. Default implementation throws,
+  // which shuts the connection down.
+  virtual void ProcessRequestChunk(std::shared_ptr<Socket> connection,
+                                   const std::string& chunk,
+                                   const MessageChunk& info);
+  // Runs on the event loop of the connection once the first bytes of the peer
+  // tell its framing, before any of its requests is processed, so messages
+  // sent from it reach the peer ahead of the responses. Default
+  // implementation does nothing.
+  virtual void OnFramingDetected(std::shared_ptr<Socket> connection);
+  // Runs on the event loop of the connection once it's removed, GetConnection
+  // doesn't find it from then on. A worker may still be processing its
+  // requests. Default implementation does nothing.
+  virtual void OnConnectionClosed(ConnectionId id);
+
+  ServerOptions options_;
+
+  AddressFamilyType listener_address_family_;
+  SocketType listener_socket_type_;
+  ProtocolType listener_protocol_;
+
+  std::atomic<bool> is_serving_;
+
+ private:
+  struct Reactor;
+
+  // Sockets handed out to the response processor and visitors are
+  // connections, so they can be mapped back without lookups.
+  struct Connection final : public Socket {
+    Connection(Socket&& connection_socket, Reactor& owner,
+               ConnectionId connection_id);
+
+    Reactor& reactor;
+    const ConnectionId id;
+
+    // guards requests and outbound data, which are shared with workers
+    std::mutex mutex;
+
+    // received requests or chunks of streamed ones waiting for a worker,
+    // along with their headers and positions
+    std::vector<std::string> requests;
+    std::vector<MessageChunk> request_chunks;
+    bool is_scheduled;
+    // requests taken by the scheduled worker, owned by it
+    std::vector<std::string> processing;
+    std::vector<MessageChunk> processing_chunks;
+    // keeps the connection alive while it's scheduled, so the task refers to
+    // it by a plain pointer and fits into std::function without allocating
+    std::shared_ptr<Connection> scheduled_self;
+
+    // framed messages waiting for the socket to become writable
+    OutboundQueue outbound;
+    bool is_write_requested;
+    bool is_overflown;
+
+    std::atomic<bool> is_closed;
+
+    // guarded by topics_mutex_ of the server
+    std::vector<std::string> topics;
+
+    // owned by the event loop
+    uint64_t serviced_round;
+    bool is_framing_detected;
+    Socket::ReceiveStage receive_stage;
+    TimerWheel::Id idle_timer;
+    TimerWheel::Id read_timer;
+    TimerWheel::Id write_timer;
+  };
+
+  using ConnectionTable = SlotMap<std::shared_ptr<Connection>>;
+
+  // updated with relaxed increments, mostly by the owning event loop
+  struct Counters {
+    std::atomic<uint64_t> accepts = 0;
+    std::atomic<uint64_t> closes = 0;
+    std::atomic<uint64_t> frames_in = 0;
+    std::atomic<uint64_t> bytes_in = 0;
+    std::atomic<uint64_t> frames_out = 0;
+    std::atomic<uint64_t> bytes_out = 0;
+    std::atomic<uint64_t> timeouts = 0;
+    std::atomic<uint64_t> evictions = 0;
+    std::atomic<uint64_t> drops = 0;
+  };
+
+  struct Reactor {
+    Reactor(size_t reactor_index, std::vector<Socket>&& reactor_listeners,
+            std::unique_ptr<Poller> reactor_poller);
+
+    // position among the reactors, ids of its connections are congruent to
+    // it modulo the number of reactors, so they are routed without a lookup
+    size_t index;
+    // of the next accepted connection, owned by the event loop
+    uint64_t next_sequence;
+
+    std::vector<Socket> listeners;
+    std::unique_ptr<Poller> poller;
+
+    Counters counters;
+
+    // buffers of requests of its connections, returned by workers
+    BufferPool buffers;
+
+    // guards connections against readers from other event loops, the owning
+    // loop takes it only to modify them
+    mutable std::mutex mutex;
+    ConnectionTable connections;
+    // indexed by descriptor, which the kernel keeps small and dense
+    std::vector<ConnectionTable::Id> connection_ids;
+    std::unordered_map<ConnectionId, ConnectionTable::Id> connections_by_id;
+
+    // connections which ran out of budget with requests left in their buffers
+    std::vector<std::shared_ptr<Connection>> backlog;
+
+    // deadlines of its connections, which are the payloads of the timers
+    TimerWheel timers;
+    std::vector<uint64_t> expired_timers;
+
+    // connections with outbound data to be watched for writability, filled
+    // from any thread, including the ones visiting connections
+    std::mutex write_requests_mutex;
+    std::vector<std::shared_ptr<Connection>> write_requests;
+  };
+
+  void RunReactor(Reactor& reactor, int timeout_msec);
+
+  // Returns true if the budget is exhausted and requests may be left.
+  // Bytes received by a poller doing the I/O are passed in, they are read
+  // from the socket otherwise.
+  bool ReceiveRequests(const std::shared_ptr<Connection>& connection,
+                       std::string_view received);
+  // Returns false until the first bytes of the peer tell its framing. The
+  // handshake reply of a binary peer is queued before its framing changes,
+  // so messages queued concurrently are framed the way the peer expects.
+  bool DetectFraming(Connection& connection);
+  void ProcessRequests(const std::shared_ptr<Connection>& connection);
+
+  // parts of the message shared by every connection it's queued to, with
+  // headers built on first use for each of the framings
+  struct FramedMessage {
+    FrameHeader header;
+    size_t size;
+    std::vector<std::shared_ptr<const std::string>> parts;
+    std::shared_ptr<const std::string> text_header;
+    std::shared_ptr<const std::string> binary_header;
+  };
+
+  static FramedMessage Frame(Message message, const FrameHeader& header);
+
+  Status Enqueue(const std::shared_ptr<Connection>& connection,
+                 FramedMessage& message);
+  // Asks the poller for the socket to become writable, or submits a send of
+  // the queued bytes if it does the I/O. Called by the owning event loop with
+  // the connection locked.
+  static void AwaitWritable(Reactor& reactor, Connection& connection);
+  // Called on a writable event, which is a completed send if the poller does
+  // the I/O.
+  void FlushConnection(Reactor& reactor,
+                       const std::shared_ptr<Connection>& connection,
+                       const PollEvent& event);
+
+  // Starts the timeout of the connection over, cancels the timer if the
+  // timeout is 0. Called by the owning event loop only.
+  static void SetTimer(Reactor& reactor, const Connection& connection,
+                       TimerWheel::Id& timer, int timeout_msec);
+  // Follows the receive stage of the connection after it's serviced,
+  // has_received tells if a request or a chunk of one was popped.
+  void UpdateReadTimers(Reactor& reactor, Connection& connection,
+                        bool has_received);
+  // Closes connections whose deadlines have passed.
+  void ExpireTimers(Reactor& reactor);
+
+  // Returns nullptr if the descriptor isn't a connection of the reactor.
+  static std::shared_ptr<Connection>* FindConnection(
+      Reactor& reactor, FileDescriptorType file_descriptor) noexcept;
+  // Bound and listening, SO_REUSEPORT is set if the port is shared.
+  Socket MakeListener(const Address& address, bool is_port_shared) const;
+  void AcceptConnection(Reactor& reactor, Socket& listener);
+  void AddConnection(Reactor& reactor, Socket&& accepted);
+  void RemoveConnection(Reactor& reactor, FileDescriptorType file_descriptor);
+  void UnsubscribeAll(const std::shared_ptr<Connection>& connection);
+
+  static void AddCounters(const Counters& counters, ServerStats& stats);
+
+  // Returns true at most once per log interval across all event loops.
+  bool IsLogDue() noexcept;
+  // Drains the stop descriptor once the event loops are gone, so the next
+  // Serve starts unstopped.
+  void ClearStop() noexcept;
+
+  // processor of the running Serve
+  const ResponseProcessor* response_processor_;
+
+  // eventfd polled by every event loop, stopping only writes to it and
+  // doesn't touch the event loops
+  FileDescriptorType stop_file_descriptor_;
+  // set by Stop and cleared once Serve is done with the event loops, so the
+  // stop can't be overwritten by Serve starting them
+  std::atomic<bool> is_stop_requested_;
+
+  // steady clock time of the next summary, in nanoseconds
+  std::atomic<int64_t> next_log_time_;
+
+  // guards the list of reactors against GetStats, which keeps the counters
+  // of the reactors of previous Serve calls in stats_
+  mutable std::mutex stats_mutex_;
+  ServerStats stats_;
 
-  Socket listener_;
-  std::vector<std::shared_ptr<Socket>> connections_;
+  std::vector<std::unique_ptr<Reactor>> reactors_;
+  std::unique_ptr<ThreadPool> workers_;
 
-  bool is_serving_;
+  // publishers share it, subscriptions take it exclusively; taken before
+  // the mutexes of connections
+  mutable std::shared_mutex topics_mutex_;
+  std::unordered_map<std::string,
+                     std::unordered_set<std::shared_ptr<Connection>>>
+      topics_;
 };
 
 }  // namespace net
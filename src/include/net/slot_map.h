@@ -0,0 +1,113 @@
+#ifndef CPP_LINUX_SOCKETS_APP_INCLUDE_NET_SLOT_MAP_H_
+#define CPP_LINUX_SOCKETS_APP_INCLUDE_NET_SLOT_MAP_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace net {
+
+// Values addressed by generational ids with O(1) insert, erase and lookup.
+// Values are kept densely packed, so iteration doesn't skip holes, while ids
+// stay valid until their value is erased and are never reused for another
+// value afterwards (until the generation of a slot wraps around).
+template <typename T>
+class SlotMap {
+ public:
+  // slot index in the low half, its generation in the high one; never 0
+  using Id = uint64_t;
+
+  constexpr static Id kInvalidId = 0;
+
+  SlotMap() : values_(), value_slots_(), slots_(), free_slots_() {}
+
+  Id Insert(T value) {
+    uint32_t slot_index;
+    if (free_slots_.empty()) {
+      slot_index = static_cast<uint32_t>(slots_.size());
+      slots_.push_back(Slot{1, 0});
+    } else {
+      slot_index = free_slots_.back();
+      free_slots_.pop_back();
+    }
+
+    Slot& slot = slots_[slot_index];
+    slot.value_index = static_cast<uint32_t>(values_.size());
+    values_.push_back(std::move(value));
+    value_slots_.push_back(slot_index);
+
+    return MakeId(slot_index, slot.generation);
+  }
+
+  // Returns the erased value, the map doesn't hold it anymore.
+  T Erase(Id id) {
+    uint32_t slot_index = static_cast<uint32_t>(id);
+    Slot& slot = slots_[slot_index];
+    uint32_t value_index = slot.value_index;
+
+    // the last value fills the hole to keep them dense
+    T erased = std::move(values_[value_index]);
+    if (value_index != values_.size() - 1) {
+      values_[value_index] = std::move(values_.back());
+      value_slots_[value_index] = value_slots_.back();
+      slots_[value_slots_[value_index]].value_index = value_index;
+    }
+    values_.pop_back();
+    value_slots_.pop_back();
+
+    if (++slot.generation == 0) {
+      slot.generation = 1;
+    }
+    free_slots_.push_back(slot_index);
+
+    return erased;
+  }
+
+  // Returns nullptr if the value was erased.
+  T* Find(Id id) noexcept {
+    uint32_t slot_index = static_cast<uint32_t>(id);
+    if (slot_index >= slots_.size() ||
+        slots_[slot_index].generation != static_cast<uint32_t>(id >> 32)) {
+      return nullptr;
+    }
+
+    return &values_[slots_[slot_index].value_index];
+  }
+  const T* Find(Id id) const noexcept {
+    return const_cast<SlotMap*>(this)->Find(id);
+  }
+
+  size_t Size() const noexcept { return values_.size(); }
+  bool Empty() const noexcept { return values_.empty(); }
+
+  // Values in no particular order, erasing invalidates iterators.
+  typename std::vector<T>::iterator begin() noexcept { return values_.begin(); }
+  typename std::vector<T>::iterator end() noexcept { return values_.end(); }
+  typename std::vector<T>::const_iterator begin() const noexcept {
+    return values_.begin();
+  }
+  typename std::vector<T>::const_iterator end() const noexcept {
+    return values_.end();
+  }
+
+ private:
+  struct Slot {
+    uint32_t generation;
+    uint32_t value_index;
+  };
+
+  static Id MakeId(uint32_t slot_index, uint32_t generation) noexcept {
+    return static_cast<Id>(generation) << 32 | slot_index;
+  }
+
+  std::vector<T> values_;
+  // slot of every value, to fix up the slot of the value moved by Erase
+  std::vector<uint32_t> value_slots_;
+  std::vector<Slot> slots_;
+  std::vector<uint32_t> free_slots_;
+};
+
+}  // namespace net
+
+#endif  // CPP_LINUX_SOCKETS_APP_INCLUDE_NET_SLOT_MAP_H_
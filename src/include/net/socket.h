@@ -3,15 +3,25 @@
 
 #include <netinet/in.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <exception>
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 #include "include/net/address.h"
+#include "include/net/frame.h"
+#include "include/net/receive_buffer.h"
 
 namespace net {
 
@@ -26,7 +36,7 @@ class SocketError : public std::logic_error {
   virtual ~SocketError() = default;
 };
 
-enum class Status { kOk, kTimeout, kClosed };
+enum class Status { kOk, kTimeout, kClosed, kDropped };
 
 template <class T>
 struct Response {
@@ -36,7 +46,13 @@ struct Response {
 
 class Socket {
  public:
+  // Progress of receiving the next message, see GetReceiveStage.
+  enum class ReceiveStage { kIdle, kHeader, kBody };
+
   constexpr static int kDefaultTimeoutMsec = 5'000;
+  constexpr static size_t kDefaultMaxMessageSize = 64 * 1'024 * 1'024;
+  constexpr static size_t kDefaultMaxStreamedMessageSize =
+      1'024 * 1'024 * 1'024;
 
   Socket(const Socket&) = delete;
   Socket& operator=(const Socket&) = delete;
@@ -60,6 +76,10 @@ class Socket {
   void MakeUnblocking();
   void SetLinger(int timeout_sec = kDefaultTimeoutMsec);
   void SetReusable();
+  void SetReusablePort();
+  // Disables Nagle's algorithm, so small pipelined messages aren't held back
+  // until the previous ones are acknowledged.
+  void SetNoDelay();
 
   void Bind(const Address& address);
   void Connect(const Address& address);
@@ -67,15 +87,133 @@ class Socket {
   void Listen(int queue_size = 1);
 
   Socket Accept();
-
+  // Single non-blocking accept, returns nullopt if no connection is pending.
+  std::optional<Socket> AcceptAvailable();
+
+  // Connected pair of Unix domain sockets, e.g. for two threads of the same
+  // process. Throws SocketError if the pair can't be created.
+  static std::pair<Socket, Socket> MakePair(
+      SocketType socket_type = SOCK_STREAM);
+
+  // Messages longer than this are rejected as soon as their header arrives,
+  // before any memory is reserved for them: receiving throws SocketError.
+  // Streamed messages aren't buffered whole and have a limit of their own,
+  // checked the same way before streaming starts.
+  void SetMaxMessageSize(size_t max_message_size) noexcept;
+  size_t GetMaxMessageSize() const noexcept;
+  void SetMaxStreamedMessageSize(size_t max_streamed_message_size) noexcept;
+  size_t GetMaxStreamedMessageSize() const noexcept;
+
+  // Text framing until binary framing is negotiated.
+  Framing GetFraming() const noexcept;
+  // 0 for text framing.
+  uint16_t GetProtocolVersion() const noexcept;
+
+  // Connecting side of the framing negotiation: offers binary framing and
+  // waits for the reply, the socket switches to binary framing on kOk. Text
+  // frames which were sent to it before the peer saw the offer are dropped.
+  // Throws SocketError if the reply isn't a valid handshake.
+  Status NegotiateFraming(int timeout_msec = kDefaultTimeoutMsec);
+  // Accepting side: tells the framing of the peer by the first bytes it has
+  // sent and consumes its handshake, if there is one. The handshake made by
+  // MakeHandshake(GetProtocolVersion()) must be sent back then, ahead of any
+  // binary frame. Returns nullopt until enough bytes are received.
+  std::optional<Framing> DetectFraming();
+
+  static std::string MakeHandshake(uint16_t version);
+
+  // Stops both directions of the connection without closing the descriptor,
+  // so the owner observes the connection as closed by the peer.
+  void Shutdown() noexcept;
+
+  // Timeouts of receiving and sending bound the whole call, they don't start
+  // over after every partial read or write.
   Response<std::string> Receive(int timeout_msec = kDefaultTimeoutMsec);
+  // Receives into the given buffer, reusing its memory, so a buffer kept by
+  // the caller stops allocating once it has grown to the largest message.
+  Status Receive(std::string& message,
+                 int timeout_msec = kDefaultTimeoutMsec);
+  // Same as above, the metadata of a binary frame goes to header.
+  Status Receive(std::string& message, FrameHeader& header,
+                 int timeout_msec = kDefaultTimeoutMsec);
+
+  // Single non-blocking read of everything the kernel has into the receive
+  // buffer. Returns kTimeout if there was nothing to read.
+  Status ReceiveAvailable();
+  // Appends bytes read elsewhere, e.g. by the poller, to the receive buffer.
+  void AppendReceived(std::string_view data);
+  // Pops the next complete message from the receive buffer, if there is any.
+  std::optional<std::string> ExtractMessage();
+  // Same as above, but into the given buffer. Returns false if there is no
+  // complete message yet, the buffer is left untouched then.
+  bool ExtractMessage(std::string& message);
+  bool ExtractMessage(std::string& message, FrameHeader& header);
+  // Length of the next complete message in the receive buffer, if any.
+  std::optional<size_t> GetNextMessageSize();
+
+  // Streaming receive: messages longer than max_chunk_size are popped in
+  // chunks of that size as soon as each of them is received, so they never
+  // take more memory than a chunk. Shorter ones are popped whole. Returns
+  // false if the next chunk isn't received yet.
+  bool ExtractChunk(std::string& chunk, MessageChunk& info,
+                    size_t max_chunk_size);
+  // Size of the next chunk, if it's received.
+  std::optional<size_t> GetNextChunkSize(size_t max_chunk_size);
+
+  // Whether the receive buffer holds nothing, a part of a header or a part
+  // of a message with its header parsed, including streamed ones.
+  ReceiveStage GetReceiveStage();
+
   Status Send(const std::string& message,
               int timeout_msec = kDefaultTimeoutMsec);
+  // The header is sent along with a binary frame and ignored by text ones.
+  Status Send(const std::string& message, const FrameHeader& header,
+              int timeout_msec = kDefaultTimeoutMsec);
+  // Sends the parts as a single message with one header. Parts are written
+  // with scatter-gather I/O, so they are never joined in memory.
+  Status SendParts(const std::vector<std::string_view>& parts,
+                   int timeout_msec = kDefaultTimeoutMsec);
+  Status SendParts(const std::vector<std::string_view>& parts,
+                   const FrameHeader& header,
+                   int timeout_msec = kDefaultTimeoutMsec);
+
+  // Single non-blocking write of raw bytes. Returns the number of written
+  // bytes, kTimeout if the socket can't take any right now.
+  Response<size_t> SendAvailable(const char* data, size_t size);
+  Response<size_t> SendAvailable(const struct iovec* buffers, size_t count);
+
+  // Header preceding every message on the wire.
+  static std::string MakeHeader(size_t message_length,
+                                Framing framing = Framing::kText,
+                                const FrameHeader& header = FrameHeader());
 
  private:
   void Close() noexcept;
 
-  Response<size_t> ReadMessageLengthHeader(int timeout_msec);
+  using Deadline = std::optional<std::chrono::steady_clock::time_point>;
+
+  // Negative timeouts mean no deadline.
+  static Deadline MakeDeadline(int timeout_msec);
+
+  // Waits for the socket to become readable or writable depending on events.
+  Status Wait(short events, const Deadline& deadline);
+  // Writes all of the buffers, adjusting them as they are written.
+  Status SendBuffers(std::vector<struct iovec>& buffers,
+                     const Deadline& deadline);
+
+  // Parses the header of the next message in the receive buffer. Returns
+  // false if it isn't complete yet, throws SocketError if it's invalid.
+  bool ParseHeader(size_t& header_length, size_t& message_length,
+                   FrameHeader& header);
+  // Returns the next chunk if it's complete, along with the number of bytes
+  // it takes in the receive buffer. Headers of streamed messages are
+  // consumed as soon as they are parsed.
+  std::optional<std::string_view> FindChunk(size_t max_chunk_size,
+                                            size_t& length,
+                                            MessageChunk& info);
+
+  constexpr static size_t kMaxHeaderLength = 20;
+  constexpr static size_t kMinReceiveSize = 4 * 1'024;
 
   AddressFamilyType address_family_;
   SocketType socket_type_;
@@ -83,6 +221,19 @@ class Socket {
   FileDescriptorType file_descriptor_;
 
   bool is_unblocking_;
+
+  Framing framing_;
+  uint16_t protocol_version_;
+
+  size_t max_message_size_;
+  size_t max_streamed_message_size_;
+  // message being streamed, its header is consumed already
+  std::optional<MessageChunk> stream_;
+
+  ReceiveBuffer receive_buffer_;
+
+  // keeps frames of concurrent senders from interleaving
+  std::mutex send_mutex_;
 };
 
 }  // namespace net
@@ -0,0 +1,88 @@
+#ifndef CPP_LINUX_SOCKETS_APP_INCLUDE_NET_STATS_H_
+#define CPP_LINUX_SOCKETS_APP_INCLUDE_NET_STATS_H_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace net {
+
+// Totals of a server since it started serving, see Server::GetStats.
+struct ServerStats {
+  uint64_t accepts = 0;
+  uint64_t closes = 0;
+  // requests, or chunks of streamed ones, and their payload bytes
+  uint64_t frames_in = 0;
+  uint64_t bytes_in = 0;
+  // messages queued to connections and their payload bytes
+  uint64_t frames_out = 0;
+  uint64_t bytes_out = 0;
+  // event loop waits which ended without any event
+  uint64_t timeouts = 0;
+  // connections closed by idle timeouts or deadlines
+  uint64_t evictions = 0;
+  // messages discarded by the overflow policy
+  uint64_t drops = 0;
+};
+
+// Log-linear histogram of latencies in the HDR style: every power of two is
+// split into kSubBucketsCount buckets, so values are kept with a relative
+// error of at most 1/kSubBucketsCount whatever their magnitude. Every thread
+// records into its own shard with plain relaxed increments, shards are only
+// merged when the histogram is read.
+class LatencyHistogram {
+ public:
+  constexpr static size_t kSubBucketsBits = 4;
+  constexpr static size_t kSubBucketsCount = size_t(1) << kSubBucketsBits;
+  // about 18 minutes in nanoseconds, longer values are clamped to it
+  constexpr static size_t kMaxValueBits = 40;
+  constexpr static size_t kBucketsCount =
+      (kMaxValueBits - kSubBucketsBits + 1) * kSubBucketsCount;
+
+  // Merged shards at the moment of reading.
+  class Snapshot {
+   public:
+    Snapshot();
+
+    // Total number of recorded values.
+    uint64_t GetCount() const noexcept;
+    // Percentile is from 0 to 100, returns 0 for an empty histogram.
+    std::chrono::nanoseconds GetPercentile(double percentile) const noexcept;
+    std::chrono::nanoseconds GetMax() const noexcept;
+
+   private:
+    friend class LatencyHistogram;
+
+    std::array<uint64_t, kBucketsCount> buckets_;
+    uint64_t count_;
+  };
+
+  // shards_count of 0 means one per core, threads beyond it share shards.
+  explicit LatencyHistogram(size_t shards_count = 0);
+
+  LatencyHistogram(const LatencyHistogram&) = delete;
+  LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+  void Record(std::chrono::nanoseconds latency) noexcept;
+
+  Snapshot Read() const noexcept;
+
+ private:
+  struct alignas(64) Shard {
+    std::array<std::atomic<uint64_t>, kBucketsCount> buckets;
+  };
+
+  static size_t GetBucket(uint64_t value) noexcept;
+  // Middle of the values of the bucket.
+  static uint64_t GetBucketValue(size_t bucket) noexcept;
+
+  size_t shards_count_;
+  std::unique_ptr<Shard[]> shards_;
+};
+
+}  // namespace net
+
+#endif  // CPP_LINUX_SOCKETS_APP_INCLUDE_NET_STATS_H_
@@ -0,0 +1,51 @@
+#ifndef CPP_LINUX_SOCKETS_APP_INCLUDE_NET_THREAD_POOL_H_
+#define CPP_LINUX_SOCKETS_APP_INCLUDE_NET_THREAD_POOL_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace net {
+
+// Fixed set of worker threads executing tasks from a bounded queue.
+class ThreadPool {
+ public:
+  using Task = std::function<void()>;
+
+  ThreadPool(size_t workers_count, size_t queue_capacity);
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  // Executes all of the queued tasks and joins the workers.
+  ~ThreadPool();
+
+  // Blocks while the queue is full. Exceptions thrown by the task are
+  // swallowed, so tasks should handle their own errors.
+  void Submit(Task task);
+
+  size_t GetWorkersCount() const noexcept;
+
+ private:
+  void Work();
+
+  size_t queue_capacity_;
+
+  std::mutex mutex_;
+  std::condition_variable has_tasks_;
+  std::condition_variable has_space_;
+  // ring of queue capacity tasks allocated once
+  std::vector<Task> tasks_;
+  size_t tasks_head_;
+  size_t tasks_count_;
+  bool is_stopping_;
+
+  std::vector<std::thread> workers_;
+};
+
+}  // namespace net
+
+#endif  // CPP_LINUX_SOCKETS_APP_INCLUDE_NET_THREAD_POOL_H_
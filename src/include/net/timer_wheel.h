@@ -0,0 +1,85 @@
+#ifndef CPP_LINUX_SOCKETS_APP_INCLUDE_NET_TIMER_WHEEL_H_
+#define CPP_LINUX_SOCKETS_APP_INCLUDE_NET_TIMER_WHEEL_H_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "include/net/slot_map.h"
+
+namespace net {
+
+// Hierarchical timing wheel: timers are hashed into lists of slots by their
+// deadline, so scheduling and cancelling are O(1) whatever the number of
+// timers. Each level has kSlotsCount slots of kSlotsCount times longer ticks
+// than the level below it, timers are moved down a level as their deadline
+// gets closer. Deadlines are rounded up to ticks, so timers never expire
+// early.
+class TimerWheel {
+ public:
+  using Clock = std::chrono::steady_clock;
+  // never 0
+  using Id = uint64_t;
+
+  constexpr static Id kInvalidId = 0;
+  constexpr static size_t kSlotsBits = 6;
+  constexpr static size_t kSlotsCount = size_t(1) << kSlotsBits;
+  // with 10 ms ticks the wheel covers about 46 hours, longer deadlines are
+  // kept in the top level until they get closer
+  constexpr static size_t kLevelsCount = 4;
+
+  explicit TimerWheel(
+      std::chrono::milliseconds tick = std::chrono::milliseconds(10),
+      Clock::time_point now = Clock::now());
+
+  // The payload is handed back once the deadline passes.
+  Id Schedule(Clock::time_point deadline, uint64_t payload);
+  // Does nothing for kInvalidId and for expired or cancelled timers.
+  void Cancel(Id id) noexcept;
+
+  // Expires all of the timers with deadlines up to now, appending their
+  // payloads to expired.
+  void Advance(Clock::time_point now, std::vector<uint64_t>& expired);
+
+  // Time left until the wheel has to be advanced, nullopt if it's empty.
+  // Deadlines far ahead are reported as the time of the next move of their
+  // timers down a level.
+  std::optional<Clock::duration> GetNextTimeout(Clock::time_point now) const;
+
+  size_t Size() const noexcept;
+
+ private:
+  struct Timer {
+    uint64_t tick;
+    uint64_t payload;
+    // neighbours in the list of its slot
+    Id previous;
+    Id next;
+    size_t slot;
+  };
+
+  // Links the timer into the slot of its level according to the ticks left.
+  void Place(Id id, Timer& timer);
+  void Unlink(Timer& timer);
+  // Moves the timers of the slot down to the lower levels.
+  void Cascade(size_t level);
+
+  // Number of whole ticks passed since the origin by the time.
+  uint64_t GetTick(Clock::time_point time) const noexcept;
+  Clock::time_point GetTime(uint64_t tick) const noexcept;
+
+  Clock::duration tick_;
+  Clock::time_point origin_;
+  // every timer up to it has expired
+  uint64_t current_tick_;
+
+  SlotMap<Timer> timers_;
+  // first timer of every slot, levels follow each other
+  std::vector<Id> slots_;
+};
+
+}  // namespace net
+
+#endif  // CPP_LINUX_SOCKETS_APP_INCLUDE_NET_TIMER_WHEEL_H_
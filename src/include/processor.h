@@ -3,17 +3,29 @@
 
 #include <istream>
 #include <string>
+#include <string_view>
+#include <utility>
 
 class Processor {
  public:
   std::string Serialize(const std::string& command,
                         const std::string& input) const;
+  // Appends serialized message to the output, so a reused output buffer
+  // doesn't allocate.
+  void SerializeTo(std::string& output, std::string_view command,
+                   std::string_view input) const;
 
   std::pair<std::string, std::string> Deserialize(
       const std::string& input) const;
+  // Same as above without copying, returned pieces point into the input.
+  std::pair<std::string_view, std::string_view> DeserializeView(
+      std::string_view input) const;
 
   std::pair<std::string, std::string> UnpackCommand(
       const std::string& command) const;
+  // Same as above without copying, returned pieces point into the command.
+  std::pair<std::string_view, std::string_view> UnpackCommandView(
+      std::string_view command) const;
 };
 
 #endif  // CPP_LINUX_SOCKETS_APP_INCLUDE_PROCESSOR_H_
@@ -0,0 +1,342 @@
+#include "include/letter_counter.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#ifdef __x86_64__
+#include <immintrin.h>
+#define LETTER_COUNTER_X86
+#endif
+
+namespace {
+
+using Histogram = LetterCounter::Histogram;
+
+// letters of the "C" locale, which the server runs in
+constexpr size_t kLettersCount = 52;
+constexpr std::array<unsigned char, kLettersCount> kLetters = [] {
+  std::array<unsigned char, kLettersCount> letters{};
+  for (size_t i = 0; i < 26; ++i) {
+    letters[i] = static_cast<unsigned char>('A' + i);
+    letters[i + 26] = static_cast<unsigned char>('a' + i);
+  }
+  return letters;
+}();
+
+bool IsLetter(unsigned char c) noexcept {
+  return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z');
+}
+
+void ClearNonLetters(Histogram& histogram) noexcept {
+  for (size_t c = 0; c < histogram.size(); ++c) {
+    if (!IsLetter(static_cast<unsigned char>(c))) {
+      histogram[c] = 0;
+    }
+  }
+}
+
+// Several tables, so repeated bytes don't wait for the previous increment of
+// the same counter to be stored.
+void CountScalar(const unsigned char* data, size_t size,
+                 Histogram& histogram) noexcept {
+  constexpr size_t kTablesCount = 4;
+  // 32 bit counters are flushed before they may overflow
+  constexpr size_t kBlockSize = size_t(1) << 30;
+
+  while (size != 0) {
+    size_t block_size = std::min(size, kBlockSize);
+    uint32_t tables[kTablesCount][256] = {};
+
+    size_t i = 0;
+    for (; i + kTablesCount <= block_size; i += kTablesCount) {
+      ++tables[0][data[i]];
+      ++tables[1][data[i + 1]];
+      ++tables[2][data[i + 2]];
+      ++tables[3][data[i + 3]];
+    }
+    for (; i < block_size; ++i) {
+      ++tables[0][data[i]];
+    }
+
+    for (size_t c = 0; c < 256; ++c) {
+      histogram[c] += uint64_t(tables[0][c]) + tables[1][c] + tables[2][c] +
+                      tables[3][c];
+    }
+
+    data += block_size;
+    size -= block_size;
+  }
+
+  ClearNonLetters(histogram);
+}
+
+#ifdef LETTER_COUNTER_X86
+
+// Vector kernels compare the data with every letter and accumulate matches
+// in byte counters. Data is taken in blocks which stay in the L1 cache while
+// they are scanned once per group of letters, and counters are summed up
+// after every block, before they may overflow.
+constexpr size_t kVectorsPerBlock = 255;
+constexpr size_t kLettersPerPass = 4;
+
+__attribute__((target("sse2"))) uint64_t SumBytes(__m128i counters) {
+  __m128i sums = _mm_sad_epu8(counters, _mm_setzero_si128());
+  return static_cast<uint64_t>(_mm_cvtsi128_si64(sums)) +
+         static_cast<uint64_t>(_mm_extract_epi16(sums, 4));
+}
+
+__attribute__((target("sse2"))) void CountSse2(const unsigned char* data,
+                                               size_t size,
+                                               Histogram& histogram) {
+  constexpr size_t kVectorSize = sizeof(__m128i);
+  size_t vectors_count = size / kVectorSize;
+
+  for (size_t block = 0; block < vectors_count; block += kVectorsPerBlock) {
+    size_t block_end = std::min(vectors_count, block + kVectorsPerBlock);
+
+    for (size_t letter = 0; letter < kLettersCount; letter += kLettersPerPass) {
+      __m128i letters[kLettersPerPass];
+      __m128i counters[kLettersPerPass];
+#pragma GCC unroll 16
+      for (size_t j = 0; j < kLettersPerPass; ++j) {
+        letters[j] = _mm_set1_epi8(static_cast<char>(kLetters[letter + j]));
+        counters[j] = _mm_setzero_si128();
+      }
+
+      // two vectors per iteration, so the loop overhead is shared
+      for (size_t i = block; i < block_end; i += 2) {
+        const auto* chunks = reinterpret_cast<const __m128i*>(data) + i;
+        __m128i first = _mm_loadu_si128(chunks);
+        __m128i second = i + 1 < block_end ? _mm_loadu_si128(chunks + 1)
+                                           : _mm_setzero_si128();
+#pragma GCC unroll 16
+        for (size_t j = 0; j < kLettersPerPass; ++j) {
+          // matching bytes are -1
+          __m128i matches = _mm_add_epi8(_mm_cmpeq_epi8(first, letters[j]),
+                                         _mm_cmpeq_epi8(second, letters[j]));
+          counters[j] = _mm_sub_epi8(counters[j], matches);
+        }
+      }
+
+      for (size_t j = 0; j < kLettersPerPass; ++j) {
+        histogram[kLetters[letter + j]] += SumBytes(counters[j]);
+      }
+    }
+  }
+
+  size_t tail = vectors_count * kVectorSize;
+  CountScalar(data + tail, size - tail, histogram);
+}
+
+__attribute__((target("avx2"))) uint64_t SumBytes(__m256i counters) {
+  __m256i sums = _mm256_sad_epu8(counters, _mm256_setzero_si256());
+  return static_cast<uint64_t>(_mm256_extract_epi64(sums, 0)) +
+         static_cast<uint64_t>(_mm256_extract_epi64(sums, 1)) +
+         static_cast<uint64_t>(_mm256_extract_epi64(sums, 2)) +
+         static_cast<uint64_t>(_mm256_extract_epi64(sums, 3));
+}
+
+__attribute__((target("avx2"))) void CountAvx2(const unsigned char* data,
+                                               size_t size,
+                                               Histogram& histogram) {
+  constexpr size_t kVectorSize = sizeof(__m256i);
+  size_t vectors_count = size / kVectorSize;
+
+  for (size_t block = 0; block < vectors_count; block += kVectorsPerBlock) {
+    size_t block_end = std::min(vectors_count, block + kVectorsPerBlock);
+
+    for (size_t letter = 0; letter < kLettersCount; letter += kLettersPerPass) {
+      __m256i letters[kLettersPerPass];
+      __m256i counters[kLettersPerPass];
+#pragma GCC unroll 16
+      for (size_t j = 0; j < kLettersPerPass; ++j) {
+        letters[j] =
+            _mm256_set1_epi8(static_cast<char>(kLetters[letter + j]));
+        counters[j] = _mm256_setzero_si256();
+      }
+
+      // two vectors per iteration, so the loop overhead is shared
+      for (size_t i = block; i < block_end; i += 2) {
+        const auto* chunks = reinterpret_cast<const __m256i*>(data) + i;
+        __m256i first = _mm256_loadu_si256(chunks);
+        __m256i second = i + 1 < block_end ? _mm256_loadu_si256(chunks + 1)
+                                           : _mm256_setzero_si256();
+#pragma GCC unroll 16
+        for (size_t j = 0; j < kLettersPerPass; ++j) {
+          // matching bytes are -1
+          __m256i matches = _mm256_add_epi8(
+              _mm256_cmpeq_epi8(first, letters[j]),
+              _mm256_cmpeq_epi8(second, letters[j]));
+          counters[j] = _mm256_sub_epi8(counters[j], matches);
+        }
+      }
+
+      for (size_t j = 0; j < kLettersPerPass; ++j) {
+        histogram[kLetters[letter + j]] += SumBytes(counters[j]);
+      }
+    }
+  }
+
+  size_t tail = vectors_count * kVectorSize;
+  CountScalar(data + tail, size - tail, histogram);
+}
+
+#endif  // LETTER_COUNTER_X86
+
+void CountWith(LetterCounter::Kernel kernel, const unsigned char* data,
+               size_t size, Histogram& histogram) {
+  switch (kernel) {
+#ifdef LETTER_COUNTER_X86
+    case LetterCounter::Kernel::kSse2:
+      CountSse2(data, size, histogram);
+      return;
+    case LetterCounter::Kernel::kAvx2:
+      CountAvx2(data, size, histogram);
+      return;
+#endif
+    default:
+      CountScalar(data, size, histogram);
+      return;
+  }
+}
+
+}  // namespace
+
+LetterCounter::LetterCounter(Kernel kernel, size_t threads_count)
+    : kernel_(kernel), threads_count_(threads_count) {
+  if (kernel_ == Kernel::kAuto) {
+    kernel_ = Kernel::kScalar;
+  }
+  if (!IsSupported(kernel_)) {
+    throw std::invalid_argument("kernel isn't supported by this cpu");
+  }
+
+  if (threads_count_ == 0) {
+    threads_count_ = std::max(1u, std::thread::hardware_concurrency());
+  }
+}
+
+bool LetterCounter::IsSupported(Kernel kernel) noexcept {
+  switch (kernel) {
+    case Kernel::kAuto:
+    case Kernel::kScalar:
+      return true;
+#ifdef LETTER_COUNTER_X86
+    case Kernel::kSse2:
+      return __builtin_cpu_supports("sse2");
+    case Kernel::kAvx2:
+      return __builtin_cpu_supports("avx2");
+#endif
+    default:
+      return false;
+  }
+}
+
+LetterCounter::Counts LetterCounter::Count(std::string_view text) const {
+  Tally tally;
+  tally.Add(*this, text);
+  return tally.GetCounts();
+}
+
+LetterCounter::Histogram LetterCounter::CountLetters(
+    std::string_view text) const {
+  const auto* data = reinterpret_cast<const unsigned char*>(text.data());
+  Histogram histogram{};
+
+  size_t threads_count =
+      std::min(threads_count_, text.size() / kMinParallelSize);
+  if (threads_count <= 1) {
+    CountWith(kernel_, data, text.size(), histogram);
+    return histogram;
+  }
+
+  // every thread counts its own slice, the calling one counts the last
+  std::vector<Histogram> partial(threads_count - 1, Histogram{});
+  std::vector<std::thread> threads;
+  threads.reserve(threads_count - 1);
+
+  size_t slice_size = text.size() / threads_count;
+  try {
+    for (size_t i = 0; i + 1 < threads_count; ++i) {
+      threads.emplace_back([this, data, slice_size, i, &partial] {
+        CountWith(kernel_, data + i * slice_size, slice_size, partial[i]);
+      });
+    }
+  } catch (...) {
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    throw;
+  }
+
+  size_t last_slice = (threads_count - 1) * slice_size;
+  CountWith(kernel_, data + last_slice, text.size() - last_slice, histogram);
+
+  for (size_t i = 0; i < threads.size(); ++i) {
+    threads[i].join();
+    for (size_t c = 0; c < histogram.size(); ++c) {
+      histogram[c] += partial[i][c];
+    }
+  }
+
+  return histogram;
+}
+
+LetterCounter::Kernel LetterCounter::GetKernel() const noexcept {
+  return kernel_;
+}
+
+LetterCounter::Tally::Tally() : histogram_{}, letters_(), text_size_(0) {}
+
+void LetterCounter::Tally::Add(const LetterCounter& counter,
+                               std::string_view piece) {
+  Histogram histogram = counter.CountLetters(piece);
+  text_size_ += piece.size();
+
+  size_t new_letters_count = 0;
+  for (size_t c = 0; c < histogram.size(); ++c) {
+    if (histogram[c] != 0 && histogram_[c] == 0) {
+      ++new_letters_count;
+    }
+  }
+
+  // the scan stops as soon as the last new letter is met, which is usually
+  // long before the end of a large piece
+  for (char c : piece) {
+    if (new_letters_count == 0) {
+      break;
+    }
+
+    auto letter = static_cast<unsigned char>(c);
+    if (histogram[letter] != 0 && histogram_[letter] == 0) {
+      letters_.push_back(c);
+      histogram_[letter] = histogram[letter];
+      histogram[letter] = 0;
+      --new_letters_count;
+    }
+  }
+
+  for (size_t c = 0; c < histogram.size(); ++c) {
+    histogram_[c] += histogram[c];
+  }
+}
+
+LetterCounter::Counts LetterCounter::Tally::GetCounts() const {
+  Counts counts;
+  counts.reserve(letters_.size());
+  for (char c : letters_) {
+    counts.emplace_back(c, histogram_[static_cast<unsigned char>(c)]);
+  }
+  return counts;
+}
+
+size_t LetterCounter::Tally::GetTextSize() const noexcept {
+  return text_size_;
+}
@@ -1,92 +1,168 @@
 #include <signal.h>
 
+#include <chrono>
 #include <exception>
+#include <future>
 #include <iostream>
+#include <mutex>
 #include <string>
 
+#include "include/command_router.h"
 #include "include/interrupt.h"
 #include "include/net/address.h"
-#include "include/net/client.h"
-#include "include/net/socket.h"
+#include "include/net/async_client.h"
+#include "include/net/frame.h"
 #include "include/processor.h"
 
+namespace {
+
+constexpr std::chrono::seconds kReplyTimeout(5);
+
+}  // namespace
+
 int main(int argc, char** argv) {
   signal(SIGINT | SIGTERM, [](int) { throw Interrupted(); });
 
   if (argc < 3) {
-    std::cerr << "There must be two parameters: address and port" << std::endl;
+    std::cerr << "There must be two parameters: address and port, or unix and "
+                 "socket path"
+              << std::endl;
+    return 1;
+  }
+
+  // the same host may be reached through a Unix domain socket
+  bool is_unix = std::string(argv[1]) == "unix";
+
+  if (argc > 3) {
+    std::cerr << "Unknown option: " << argv[3] << std::endl;
     return 1;
   }
 
   Processor processor;
+
+  // replies of the server, the ones without a handler are printed as they are
+  CommandRouter<void(const Command&)> replies;
+  replies.Register("send", [&processor](const Command& reply) {
+    auto [sender, message] = processor.UnpackCommandView(reply.argument);
+    std::cout << "Received message from client " << sender << ": " << message
+              << std::endl;
+  });
+  // pushed by the server right after connecting, other clients send
+  // messages to this one by it
+  replies.Register("id", [](const Command& reply) {
+    std::cout << "Client id: " << reply.argument << std::endl;
+  });
+  replies.Register("list", [](const Command& reply) {
+    std::cout << "Connected clients: " << reply.argument << std::endl;
+  });
+  replies.Register("publish", [&processor](const Command& reply) {
+    auto [topic, message] = processor.UnpackCommandView(reply.argument);
+    std::cout << "Received message on " << topic << ": " << message
+              << std::endl;
+  });
+  replies.Register("subscribe", [](const Command& reply) {
+    std::cout << "Subscribed to " << reply.argument << std::endl;
+  });
+  replies.Register("unsubscribe", [](const Command& reply) {
+    std::cout << "Unsubscribed from " << reply.argument << std::endl;
+  });
+  replies.Register("err", [](const Command& reply) {
+    std::cout << "Error response: " << reply.argument << std::endl;
+  });
+  auto print_table = [](const Command& reply) {
+    std::cout << "Reply from server:" << std::endl
+              << reply.argument << std::endl;
+  };
+  replies.Register("count", print_table);
+  replies.Register("stats", print_table);
+
+  // replies are printed by the main thread, broadcasts by the one of the
+  // client as soon as they arrive
+  std::mutex print_mutex;
+  auto print_reply = [&processor, &replies,
+                      &print_mutex](const std::string& data) {
+    auto [reply_name, reply_argument] = processor.DeserializeView(data);
+    Command reply{reply_name, reply_argument, data};
+
+    std::lock_guard lock(print_mutex);
+    const auto* reply_handler = replies.Find(reply_name);
+    if (reply_handler != nullptr) {
+      (*reply_handler)(reply);
+    } else {
+      std::cout << "Reply from server: " << reply.argument << std::endl;
+    }
+  };
+
+  // commands of the user, which return false if the client should exit
+  CommandRouter<bool(const Command&, net::AsyncClient&)> commands;
+  std::string request;  // reused for every request
+  auto request_server = [&processor, &request, &print_reply](
+                            const Command& command, net::AsyncClient& client) {
+    request.clear();
+    processor.SerializeTo(request, command.name, command.argument);
+    auto reply = client.Request(request);
+    if (reply.wait_for(kReplyTimeout) == std::future_status::timeout) {
+      std::cerr << "Timed out waiting for the reply" << std::endl;
+    } else {
+      print_reply(reply.get());
+    }
+    return true;
+  };
+  commands.Register("count", request_server);
+  commands.Register("connections", request_server);
+  commands.Register("list", request_server);
+  commands.Register("stats", request_server);
+  commands.Register("subscribe", request_server);
+  commands.Register("unsubscribe", request_server);
+  // broadcasts and publications get no reply, errors of sends are pushed
+  auto send_to_server = [&processor, &request](const Command& command,
+                                               net::AsyncClient& client) {
+    request.clear();
+    processor.SerializeTo(request, command.name, command.argument);
+    client.Send(request);
+    return true;
+  };
+  commands.Register("send", send_to_server);
+  commands.Register("publish", send_to_server);
+  commands.Register("exit", [](const Command&, net::AsyncClient&) {
+    std::cerr << "Exiting..." << std::endl;
+    return false;
+  });
+
   const size_t kMaxRetries = 3;
   size_t retries = 0;
 
   while (retries < kMaxRetries) {
     try {
-      net::Client client;
-      client.Connect(net::Address(argv[1], std::stoi(argv[2])));
+      net::AsyncClient client(is_unix ? AF_UNIX : AF_INET);
+      client.Subscribe(
+          [&print_reply](const std::string& data, const net::FrameHeader&) {
+            print_reply(data);
+          });
+      client.Connect(is_unix ? net::Address::FromPath(argv[2])
+                             : net::Address(argv[1], std::stoi(argv[2])));
       std::cerr << "Connected succesfully" << std::endl;
       retries = 0;
 
       while (true) {
-        std::cout << "Available commands: count <message> | connections | send "
-                     "<client id> <message> | exit"
+        std::cout << "Available commands: count <message> | connections | "
+                     "list | send [@<client id>] <message> | "
+                     "subscribe <topic> | unsubscribe <topic> | "
+                     "publish <topic> <message> | stats | exit"
                   << std::endl;
 
         std::cout << "Input your command: ";
         std::string command;
         std::getline(std::cin, command);
-        auto unpacked_command = processor.UnpackCommand(command);
-
-        if (unpacked_command.first == "exit") {
-          std::cerr << "Exiting..." << std::endl;
-          break;
-        }
+        auto [name, argument] = processor.UnpackCommandView(command);
 
-        if (unpacked_command.first == "count" ||
-            unpacked_command.first == "connections" ||
-            unpacked_command.first == "send") {
-          client.Send(processor.Serialize(unpacked_command.first,
-                                          unpacked_command.second));
-        } else {
-          std::cerr << "Unknown command: " << unpacked_command.first
-                    << std::endl;
+        const auto* handler = commands.Find(name);
+        if (handler == nullptr) {
+          std::cerr << "Unknown command: " << name << std::endl;
           continue;
         }
-
-        bool is_first_poll = true;
-        while (true) {
-          auto response = client.Receive(is_first_poll ? 100 : 0);
-          is_first_poll = false;
-
-          if (response.status == net::Status::kClosed) {
-            throw net::ClientError("connection closed");
-          }
-          if (response.status == net::Status::kTimeout) {
-            if (is_first_poll) {
-              std::cerr << "Timed out for checking new messages" << std::endl;
-            }
-            break;
-          }
-
-          auto deserialized = processor.Deserialize(response.data);
-
-          if (deserialized.first == "send") {
-            std::cout << "Received message from client: " << deserialized.second
-                      << std::endl;
-          } else if (deserialized.first == "err") {
-            std::cout << "Error response: " << deserialized.second << std::endl;
-          } else {
-            std::cout << "Reply from server:";
-            if (deserialized.first == "count") {
-              std::cout << std::endl << deserialized.second;
-            } else {
-              std::cout << ' ' << deserialized.second;
-            }
-
-            std::cout << std::endl;
-          }
+        if (!(*handler)(Command{name, argument, command}, client)) {
+          break;
         }
       }
 
@@ -1,112 +1,599 @@
-#include <cctype>
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
 #include <csignal>
+#include <cstdio>
 #include <cstddef>
+#include <cstdint>
 #include <exception>
+#include <fstream>
 #include <iostream>
 #include <memory>
+#include <mutex>
 #include <sstream>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <thread>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
-#include "include/interrupt.h"
+#include "include/command_router.h"
+#include "include/count_cache.h"
+#include "include/count_table.h"
+#include "include/letter_counter.h"
 #include "include/net/address.h"
+#include "include/net/frame.h"
+#include "include/net/message.h"
 #include "include/net/server.h"
 #include "include/net/socket.h"
+#include "include/net/stats.h"
 #include "include/processor.h"
 
-struct CustomResponseProcessor {
-  std::vector<std::shared_ptr<net::Socket>>& connections;
-  Processor processor;
+class CustomServer final : public net::Server {
+ public:
+  using Router = CommandRouter<net::Message(
+      const Command&, const std::shared_ptr<net::Socket>&)>;
+
+  // count_cache_capacity is in bytes, 0 disables caching of count tables.
+  // Tables of count show the size of the message instead of the message
+  // unless it's echoed.
+  CustomServer(const net::ServerOptions& options, size_t count_cache_capacity,
+               bool is_count_message_echoed)
+      : net::Server(options),
+        processor_(),
+        letter_counter_(),
+        count_cache_(count_cache_capacity),
+        is_count_message_echoed_(is_count_message_echoed),
+        router_(),
+        latencies_(),
+        streams_mutex_(),
+        streams_() {
+    Register("connections", &CustomServer::Connections);
+    Register("id", &CustomServer::Id);
+    Register("list", &CustomServer::List);
+    Register("count", &CustomServer::Count);
+    Register("send", &CustomServer::SendToOthers);
+    Register("stats", &CustomServer::Stats);
+    Register("subscribe", &CustomServer::SubscribeToTopic);
+    Register("unsubscribe", &CustomServer::UnsubscribeFromTopic);
+    Register("publish", &CustomServer::PublishToTopic);
+  }
 
-  std::string operator()(std::shared_ptr<net::Socket> connection,
-                         const std::string& message) const {
-    auto deserialized = processor.Deserialize(message);
+  // Counters of the server followed by latencies of every command.
+  std::string FormatStats() const {
+    net::ServerStats stats = GetStats();
+    CountCache::Stats count_cache_stats = count_cache_.GetStats();
 
-    if (deserialized.first == "connections") {
-      return processor.Serialize("connections",
-                                 std::to_string(connections.size()));
+    std::ostringstream ss;
+    ss << "accepts | " << stats.accepts << "\n"
+       << "closes | " << stats.closes << "\n"
+       << "frames in | " << stats.frames_in << "\n"
+       << "bytes in | " << stats.bytes_in << "\n"
+       << "frames out | " << stats.frames_out << "\n"
+       << "bytes out | " << stats.bytes_out << "\n"
+       << "timeouts | " << stats.timeouts << "\n"
+       << "evictions | " << stats.evictions << "\n"
+       << "drops | " << stats.drops << "\n"
+       << "count cache hits | " << count_cache_stats.hits << "\n"
+       << "count cache misses | " << count_cache_stats.misses << "\n"
+       << "count cache entries | " << count_cache_stats.entries << "\n"
+       << "count cache bytes | " << count_cache_stats.bytes << "\n"
+       << "command | requests | p50, us | p99, us | max, us";
+
+    auto to_microseconds = [](std::chrono::nanoseconds latency) {
+      return std::chrono::duration<double, std::micro>(latency).count();
+    };
+    ss.setf(std::ios::fixed);
+    ss.precision(1);
+    for (const auto& [name, latency] : latencies_) {
+      auto snapshot = latency->Read();
+      ss << "\n"
+         << name << " | " << snapshot.GetCount() << " | "
+         << to_microseconds(snapshot.GetPercentile(50)) << " | "
+         << to_microseconds(snapshot.GetPercentile(99)) << " | "
+         << to_microseconds(snapshot.GetMax());
     }
 
-    if (deserialized.first == "count") {
-      // pretty-print table of letters
-      std::unordered_map<char, size_t> counts;
-      for (char c : deserialized.second) {
-        if (std::isalpha(c)) {
-          ++counts[c];
-        }
-      }
+    return ss.str();
+  }
 
-      std::string message_header = "Message";
+ protected:
+  virtual void ProcessRequest(std::shared_ptr<net::Socket> connection,
+                              const std::string& request,
+                              const net::FrameHeader& header,
+                              const ResponseProcessor&) override {
+    // pieces point into the request, which outlives this call
+    auto [name, argument] = processor_.DeserializeView(request);
 
-      std::stringstream ss;
-      ss << message_header << " | " << deserialized.second << "\n";
-      bool comma = false;
-      for (char c : deserialized.second) {
-        auto pos = counts.find(c);
-        if (pos == counts.end()) {
-          continue;
-        }
+    const auto* handler = router_.Find(name);
+    if (handler == nullptr) {
+      return;
+    }
 
-        if (comma) {
-          ss << "\n";
-        }
-        comma = true;
+    net::Message response =
+        (*handler)(Command{name, argument, request}, connection);
+    if (!response.Empty()) {
+      Send(connection, std::move(response),
+           net::FrameHeader{header.request_id, header.command_id, 0});
+    }
+  }
 
-        ss << c;
-        for (size_t i = 0; i < message_header.size() - 1; ++i) {
-          ss << ' ';
+  // Only count is streamed, its letters are tallied chunk by chunk, so a
+  // large upload is counted in constant memory. Other commands close the
+  // connection rather than take the rest of the body.
+  virtual void ProcessRequestChunk(std::shared_ptr<net::Socket> connection,
+                                   const std::string& chunk,
+                                   const net::MessageChunk& info) override {
+    ConnectionId id = GetConnectionId(connection);
+    std::shared_ptr<StreamedRequest> request;
+    {
+      std::lock_guard lock(streams_mutex_);
+      if (info.offset == 0) {
+        // the entry of a closed connection would never be erased
+        if (GetConnection(id) == nullptr) {
+          return;
         }
-        ss << " | " << pos->second;
-        counts.erase(pos);
+        request = std::make_shared<StreamedRequest>();
+        streams_[id] = request;
+      } else {
+        auto found = streams_.find(id);
+        if (found == streams_.end()) {
+          // the request was rejected or its connection is closed
+          return;
+        }
+        request = found->second;
       }
+    }
 
-      return processor.Serialize("count", ss.str());
+    if (info.offset == 0) {
+      auto [name, argument] = processor_.DeserializeView(chunk);
+      if (name != "count") {
+        Send(connection, processor_.Serialize("err", "request is too large"),
+             net::FrameHeader{info.header.request_id,
+                              info.header.command_id, 0});
+        connection->Shutdown();
+
+        std::lock_guard lock(streams_mutex_);
+        streams_.erase(id);
+        return;
+      }
+      request->tally.Add(letter_counter_, argument);
+    } else {
+      request->tally.Add(letter_counter_, chunk);
     }
 
-    if (deserialized.first == "send") {
-      for (const auto& conn : connections) {
-        if (connection->GetFileDescriptor() != conn->GetFileDescriptor()) {
-          conn->Send(message);
-        }
+    if (info.offset + chunk.size() != info.message_size) {
+      return;
+    }
+
+    Send(connection,
+         std::vector<std::string>{
+             processor_.Serialize("count", ""),
+             FormatCountTable(DescribeSize(request->tally.GetTextSize()),
+                              request->tally.GetCounts())},
+         net::FrameHeader{info.header.request_id, info.header.command_id, 0});
+
+    std::lock_guard lock(streams_mutex_);
+    streams_.erase(id);
+  }
+
+  // Binary peers get their id pushed right after the handshake. Text frames
+  // carry no request ids, so a push would be taken for the reply to the
+  // first request; text peers ask with the id command instead.
+  virtual void OnFramingDetected(
+      std::shared_ptr<net::Socket> connection) override {
+    if (connection->GetFraming() == net::Framing::kBinary) {
+      Send(connection,
+           processor_.Serialize("id",
+                                std::to_string(GetConnectionId(connection))));
+    }
+  }
+
+  // streams cut short by their connections are dropped
+  virtual void OnConnectionClosed(ConnectionId id) override {
+    std::lock_guard lock(streams_mutex_);
+    streams_.erase(id);
+  }
+
+ private:
+  net::Message Connections(const Command&,
+                           const std::shared_ptr<net::Socket>&) {
+    return processor_.Serialize("connections",
+                                std::to_string(GetConnectionsCount()));
+  }
+
+  net::Message Id(const Command&,
+                  const std::shared_ptr<net::Socket>& connection) {
+    return processor_.Serialize("id",
+                                std::to_string(GetConnectionId(connection)));
+  }
+
+  // ids of every connected client in ascending order, separated by spaces
+  net::Message List(const Command&, const std::shared_ptr<net::Socket>&) {
+    std::vector<ConnectionId> ids;
+    ForEachConnection([this, &ids](const std::shared_ptr<net::Socket>& peer) {
+      ids.push_back(GetConnectionId(peer));
+    });
+    std::sort(ids.begin(), ids.end());
+
+    std::string list;
+    for (auto id : ids) {
+      if (!list.empty()) {
+        list.push_back(' ');
+      }
+      list.append(std::to_string(id));
+    }
+
+    return processor_.Serialize("list", list);
+  }
+
+  using Handler = net::Message (CustomServer::*)(
+      const Command&, const std::shared_ptr<net::Socket>&);
+
+  // Handlers are timed into a latency histogram of their command.
+  void Register(std::string_view name, Handler handler) {
+    latencies_.emplace_back(std::string(name),
+                            std::make_unique<net::LatencyHistogram>());
+    net::LatencyHistogram* latency = latencies_.back().second.get();
+
+    router_.Register(name, [this, handler, latency](
+                               const Command& command,
+                               const std::shared_ptr<net::Socket>& connection) {
+      auto start = std::chrono::steady_clock::now();
+      net::Message response = (this->*handler)(command, connection);
+      latency->Record(std::chrono::steady_clock::now() - start);
+      return response;
+    });
+  }
+
+  struct StreamedRequest {
+    LetterCounter::Tally tally;
+  };
+
+  // Repeated messages are answered from the cache without counting them.
+  net::Message Count(const Command& command,
+                     const std::shared_ptr<net::Socket>&) {
+    std::shared_ptr<const std::string> table;
+    if (count_cache_.IsEnabled()) {
+      uint32_t hash = CountCache::Hash(command.argument);
+      table = count_cache_.Find(hash, command.argument);
+      if (!table) {
+        table = std::make_shared<const std::string>(
+            MakeTable(command.argument));
+        count_cache_.Insert(hash, command.argument, table);
       }
+    } else {
+      table = std::make_shared<const std::string>(MakeTable(command.argument));
+    }
+
+    // command prefix and the table are sent without joining them, a cached
+    // table is shared with the cache rather than copied
+    return std::vector<net::Message::Part>{
+        std::make_shared<const std::string>(processor_.Serialize("count", "")),
+        std::move(table)};
+  }
+
+  // table of letters in the order of their first occurrence
+  std::string MakeTable(std::string_view message) const {
+    LetterCounter::Counts counts = letter_counter_.Count(message);
+    if (!is_count_message_echoed_) {
+      return FormatCountTable(DescribeSize(message.size()), counts);
+    }
+    return FormatCountTable(message, counts);
+  }
+
+  // stands for a message which isn't echoed
+  static std::string DescribeSize(size_t size) {
+    return "<" + std::to_string(size) + " bytes>";
+  }
+
+  net::Message Stats(const Command&, const std::shared_ptr<net::Socket>&) {
+    return processor_.Serialize("stats", FormatStats());
+  }
+
+  // Sends to the client addressed as @<id> by the first word, or to every
+  // other client if the first word doesn't start with @, so a message which
+  // merely starts with a number is broadcast. Receivers get the id of the
+  // sender followed by the message.
+  net::Message SendToOthers(const Command& command,
+                            const std::shared_ptr<net::Socket>& connection) {
+    std::string sender = std::to_string(GetConnectionId(connection));
+    auto [target, message] = processor_.UnpackCommandView(command.argument);
+    if (target.empty() || target.front() != '@') {
+      Broadcast(processor_.Serialize(
+                    "send", sender + " " + std::string(command.argument)),
+                connection);
+      return "";
     }
 
+    target.remove_prefix(1);
+    ConnectionId id = 0;
+    auto [end, error] =
+        std::from_chars(target.data(), target.data() + target.size(), id);
+    if (target.empty() || error != std::errc() ||
+        end != target.data() + target.size()) {
+      return processor_.Serialize("err", "invalid client id");
+    }
+
+    auto peer = GetConnection(id);
+    if (!peer) {
+      return processor_.Serialize("err", "no client with this id");
+    }
+
+    Send(peer,
+         processor_.Serialize("send", sender + " " + std::string(message)));
+    return "";
+  }
+
+  // Topics are single words, the rest of the argument is the message.
+  std::pair<std::string_view, std::string_view> UnpackTopic(
+      std::string_view argument) const {
+    return processor_.UnpackCommandView(argument);
+  }
+
+  // The reply tells the client that publications reach it from then on.
+  net::Message SubscribeToTopic(
+      const Command& command, const std::shared_ptr<net::Socket>& connection) {
+    auto [topic, rest] = UnpackTopic(command.argument);
+    if (topic.empty() || !rest.empty()) {
+      return processor_.Serialize("err", "topic must be a single word");
+    }
+
+    Subscribe(connection, std::string(topic));
+    return processor_.Serialize("subscribe", std::string(topic));
+  }
+
+  net::Message UnsubscribeFromTopic(
+      const Command& command, const std::shared_ptr<net::Socket>& connection) {
+    auto [topic, rest] = UnpackTopic(command.argument);
+    if (!Unsubscribe(connection, std::string(topic))) {
+      return processor_.Serialize("err", "not subscribed to the topic");
+    }
+
+    return processor_.Serialize("unsubscribe", std::string(topic));
+  }
+
+  // Subscribers get the request as it is, publishers get no reply, like
+  // senders of send.
+  net::Message PublishToTopic(const Command& command,
+                              const std::shared_ptr<net::Socket>&) {
+    auto [topic, message] = UnpackTopic(command.argument);
+    if (!topic.empty()) {
+      Publish(std::string(topic), std::string(command.text));
+    }
     return "";
   }
+
+  Processor processor_;
+  LetterCounter letter_counter_;
+  CountCache count_cache_;
+  const bool is_count_message_echoed_;
+  Router router_;
+  // in the order of registration
+  std::vector<std::pair<std::string, std::unique_ptr<net::LatencyHistogram>>>
+      latencies_;
+
+  // count requests being streamed by their connections, taken before the
+  // mutexes of the server
+  std::mutex streams_mutex_;
+  std::unordered_map<ConnectionId, std::shared_ptr<StreamedRequest>> streams_;
 };
 
-class CustomServer final : public net::Server {
+// Periodically replaces the file with the stats of the server, the file is
+// written next to it first, so readers never see it half written.
+class StatsDumper {
  public:
-  CustomServer() : net::Server() {}
+  StatsDumper(const CustomServer& server, std::string path,
+              std::chrono::seconds interval)
+      : server_(server),
+        path_(std::move(path)),
+        interval_(interval),
+        mutex_(),
+        is_stopping_cv_(),
+        is_stopping_(false),
+        thread_() {
+    if (!path_.empty()) {
+      thread_ = std::thread([this] { Run(); });
+    }
+  }
 
- protected:
-  virtual void ProcessConnection(std::shared_ptr<net::Socket> connection,
-                                 const ResponseProcessor&) override {
-    CustomResponseProcessor processor{connections_, Processor()};
-    return net::Server::ProcessConnection(connection, processor);
+  ~StatsDumper() {
+    {
+      std::lock_guard lock(mutex_);
+      is_stopping_ = true;
+    }
+    is_stopping_cv_.notify_one();
+
+    if (thread_.joinable()) {
+      thread_.join();
+    }
+  }
+
+ private:
+  void Run() {
+    std::unique_lock lock(mutex_);
+    while (!is_stopping_cv_.wait_for(lock, interval_,
+                                     [this] { return is_stopping_; })) {
+      std::string temporary_path = path_ + ".tmp";
+      {
+        std::ofstream file(temporary_path, std::ios::trunc);
+        file << server_.FormatStats() << std::endl;
+        if (!file) {
+          std::cerr << "Can't write stats to " << temporary_path << std::endl;
+          continue;
+        }
+      }
+      std::rename(temporary_path.c_str(), path_.c_str());
+    }
   }
+
+  const CustomServer& server_;
+  std::string path_;
+  std::chrono::seconds interval_;
+
+  std::mutex mutex_;
+  std::condition_variable is_stopping_cv_;
+  bool is_stopping_;
+  std::thread thread_;
+};
+
+struct Options {
+  net::ServerOptions server;
+
+  // clients on the same host may connect through it besides the port, not
+  // listened on if empty
+  std::string unix_socket_path;
+
+  // bytes of count tables and their messages kept for repeated messages
+  size_t count_cache_capacity = 64 * 1'024 * 1'024;
+  bool is_count_message_echoed = true;
+
+  // stats aren't dumped if the path is empty
+  std::string stats_path;
+  std::chrono::seconds stats_interval{10};
 };
 
+// parses optional "--name=value" parameters following the port
+Options ParseOptions(int argc, char** argv) {
+  Options parsed;
+  net::ServerOptions& options = parsed.server;
+
+  for (int i = 2; i < argc; ++i) {
+    std::string option = argv[i];
+    auto equals_pos = option.find('=');
+    std::string name = option.substr(0, equals_pos);
+    std::string value =
+        equals_pos == std::string::npos ? "" : option.substr(equals_pos + 1);
+
+    if (name == "--reactors") {
+      options.reactors_count = std::stoul(value);
+    } else if (name == "--workers") {
+      options.workers_count = std::stoul(value);
+    } else if (name == "--tasks-queue") {
+      options.tasks_queue_capacity = std::stoul(value);
+    } else if (name == "--requests-per-wakeup") {
+      options.max_requests_per_wakeup = std::stoul(value);
+    } else if (name == "--max-message-size") {
+      options.max_message_size = std::stoul(value);
+    } else if (name == "--streaming-threshold") {
+      options.streaming_threshold = std::stoul(value);
+    } else if (name == "--max-streamed-message-size") {
+      options.max_streamed_message_size = std::stoul(value);
+    } else if (name == "--idle-timeout") {
+      options.idle_timeout_msec = std::stoi(value);
+    } else if (name == "--header-timeout") {
+      options.header_timeout_msec = std::stoi(value);
+    } else if (name == "--body-timeout") {
+      options.body_timeout_msec = std::stoi(value);
+    } else if (name == "--write-stall-timeout") {
+      options.write_stall_timeout_msec = std::stoi(value);
+    } else if (name == "--outbound-high-watermark") {
+      options.outbound_high_watermark = std::stoul(value);
+    } else if (name == "--outbound-low-watermark") {
+      options.outbound_low_watermark = std::stoul(value);
+    } else if (name == "--overflow-policy") {
+      if (value == "disconnect") {
+        options.overflow_policy = net::OverflowPolicy::kDisconnect;
+      } else if (value == "drop") {
+        options.overflow_policy = net::OverflowPolicy::kDrop;
+      } else {
+        throw std::invalid_argument("unknown overflow policy: " + value);
+      }
+    } else if (name == "--log-level") {
+      if (value == "silent") {
+        options.log_level = net::LogLevel::kSilent;
+      } else if (value == "info") {
+        options.log_level = net::LogLevel::kInfo;
+      } else if (value == "debug") {
+        options.log_level = net::LogLevel::kDebug;
+      } else {
+        throw std::invalid_argument("unknown log level: " + value);
+      }
+    } else if (name == "--log-interval") {
+      options.log_interval_msec = std::stoi(value);
+    } else if (name == "--count-cache") {
+      parsed.count_cache_capacity = std::stoul(value);
+    } else if (name == "--count-message") {
+      if (value == "echo") {
+        parsed.is_count_message_echoed = true;
+      } else if (value == "size") {
+        parsed.is_count_message_echoed = false;
+      } else {
+        throw std::invalid_argument("unknown count message: " + value);
+      }
+    } else if (name == "--unix-socket") {
+      parsed.unix_socket_path = value;
+    } else if (name == "--stats-file") {
+      parsed.stats_path = value;
+    } else if (name == "--stats-interval") {
+      parsed.stats_interval = std::chrono::seconds(std::stoul(value));
+    } else if (name == "--poller") {
+      if (value == "poll") {
+        options.poller_type = net::PollerType::kPoll;
+      } else if (value == "epoll") {
+        options.poller_type = net::PollerType::kEpoll;
+      } else if (value == "uring") {
+        options.poller_type = net::PollerType::kUring;
+      } else {
+        throw std::invalid_argument("unknown poller: " + value);
+      }
+    } else {
+      throw std::invalid_argument("unknown option: " + name);
+    }
+  }
+
+  return parsed;
+}
+
+// stopping only sets a flag and writes to an eventfd, so it's
+// async-signal-safe, unlike unwinding out of a system call
+std::atomic<net::Server*> interruptible_server = nullptr;
+std::atomic<bool> is_interrupted = false;
+
 int main(int argc, char** argv) {
-  signal(SIGINT, [](int) { throw Interrupted(); });
+  signal(SIGINT, [](int) {
+    is_interrupted = true;
+    if (net::Server* server = interruptible_server) {
+      server->Stop();
+    }
+  });
 
   if (argc < 2) {
-    std::cerr << "There must be only one parameter - port" << std::endl;
+    std::cerr << "First parameter must be a port" << std::endl;
     return 1;
   }
 
   try {
-    CustomServer server;
+    Options options = ParseOptions(argc, argv);
+    CustomServer server(options.server, options.count_cache_capacity,
+                        options.is_count_message_echoed);
+    StatsDumper stats_dumper(server, options.stats_path,
+                             options.stats_interval);
+    interruptible_server = &server;
+
+    std::vector<net::Address> addresses{
+        net::Address("any", std::stoi(argv[1]))};
+    if (!options.unix_socket_path.empty()) {
+      addresses.push_back(net::Address::FromPath(options.unix_socket_path));
+    }
 
     // processor parameter will be ignored
     server.Serve(
-        net::Address("any", std::stoi(argv[1])),
+        addresses,
         [](std::shared_ptr<net::Socket>, const std::string&) { return ""; },
         60'000 * 60);
+    interruptible_server = nullptr;
   } catch (const std::exception& e) {
+    interruptible_server = nullptr;
     std::cerr << e.what() << std::endl;
     return 1;
-  } catch (const Interrupted& e) {
+  }
+
+  if (is_interrupted) {
     std::cerr << "Exiting..." << std::endl;
     return 1;
   }
@@ -3,7 +3,10 @@
 #include <arpa/inet.h>
 #include <netinet/in.h>
 #include <strings.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 
+#include <cstddef>
 #include <stdexcept>
 #include <string>
 
@@ -25,10 +28,36 @@ Address Address::FromString(const std::string& address,
   return Address(address_str, std::stoi(port_str), address_family);
 }
 
+Address Address::FromPath(const std::string& path) {
+  Address address;
+  // the terminating zero is kept for file paths, abstract ones are counted
+  // by the length only
+  if (path.empty() || path.size() >= sizeof(address.path_info_.sun_path)) {
+    throw AddressError("invalid path");
+  }
+
+  address.path_info_.sun_family = AF_UNIX;
+  path.copy(address.path_info_.sun_path, path.size());
+  size_t path_length = path.size() + 1;
+  if (path.front() == '@') {
+    address.path_info_.sun_path[0] = '\0';
+    path_length = path.size();
+  }
+  address.address_info_length_ =
+      offsetof(struct sockaddr_un, sun_path) + path_length;
+
+  return address;
+}
+
+Address::Address() noexcept
+    : path_info_(), address_info_length_(sizeof(path_info_)) {
+  bzero((char*)&path_info_, sizeof(path_info_));
+}
+
 Address::Address(const std::string& ip, unsigned port,
                  AddressFamilyType address_family)
-    : address_info_() {
-  bzero((char*)&address_info_, sizeof(address_info_));
+    : Address() {
+  address_info_length_ = sizeof(address_info_);
 
   int status_code;
 
@@ -50,13 +79,53 @@ Address::Address(const std::string& ip, unsigned port,
 }
 
 AddressType Address::GetAddress() const noexcept {
+  if (GetAddressFamily() == AF_UNIX) {
+    return 0;
+  }
+
   return address_info_.sin_addr.s_addr;
 }
 
-PortType Address::GetPort() const noexcept { return address_info_.sin_port; }
+PortType Address::GetPort() const noexcept {
+  if (GetAddressFamily() == AF_UNIX) {
+    return 0;
+  }
+
+  return address_info_.sin_port;
+}
+
+AddressFamilyType Address::GetAddressFamily() const noexcept {
+  // the family goes first in both structures
+  return path_info_.sun_family;
+}
+
+std::string Address::GetPath() const {
+  if (GetAddressFamily() != AF_UNIX) {
+    return "";
+  }
+
+  size_t path_offset = offsetof(struct sockaddr_un, sun_path);
+  std::string path(path_info_.sun_path,
+                   address_info_length_ - path_offset);
+  if (path.front() == '\0') {
+    path.front() = '@';
+  } else {
+    path.pop_back();
+  }
+
+  return path;
+}
 
 struct sockaddr_in Address::GetAddressInfo() const noexcept {
   return address_info_;
 }
 
+const struct sockaddr* Address::GetSockAddr() const noexcept {
+  return reinterpret_cast<const struct sockaddr*>(&path_info_);
+}
+
+socklen_t Address::GetSockAddrLength() const noexcept {
+  return address_info_length_;
+}
+
 }  // namespace net
@@ -0,0 +1,309 @@
+#include "include/net/async_client.h"
+
+#include <pthread.h>
+#include <signal.h>
+#include <sys/socket.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "include/net/client.h"
+#include "include/net/frame.h"
+#include "include/net/poller.h"
+#include "include/net/socket.h"
+
+namespace net {
+
+AsyncClient::AsyncClient(AddressFamilyType address_family,
+                         SocketType socket_type, ProtocolType protocol,
+                         PollerType poller_type)
+    : socket_(std::nullopt, address_family, socket_type, protocol),
+      poller_type_(poller_type),
+      poller_(),
+      is_closing_(false),
+      mutex_(),
+      is_connected_(false),
+      next_request_id_(1),
+      next_send_id_(0),
+      pending_(),
+      outbound_(),
+      is_write_requested_(false),
+      push_mutex_(),
+      push_callback_(),
+      io_thread_() {}
+
+AsyncClient::~AsyncClient() { Close(); }
+
+void AsyncClient::Connect(const Address& address, int timeout_msec) {
+  if (io_thread_.joinable()) {
+    throw ClientError("this client is already connected");
+  }
+  // the socket is shut down by Close and can't be connected again
+  if (is_closing_) {
+    throw ClientError("this client is closed");
+  }
+
+  socket_.Connect(address);
+  if (socket_.GetAddressFamily() == AF_INET &&
+      socket_.GetSocketType() == SOCK_STREAM) {
+    socket_.SetNoDelay();
+  }
+
+  Status status;
+  try {
+    status = socket_.NegotiateFraming(timeout_msec);
+  } catch (const SocketError&) {
+    status = Status::kClosed;
+  }
+  if (status != Status::kOk) {
+    throw ClientError("can't negotiate binary framing");
+  }
+
+  socket_.MakeUnblocking();
+  poller_ = Poller::Create(poller_type_);
+  poller_->Add(socket_.GetFileDescriptor());
+
+  {
+    std::lock_guard lock(mutex_);
+    is_connected_ = true;
+  }
+
+  // signals stay with the threads of the caller, whose handlers may throw
+  sigset_t all_signals;
+  sigset_t previous_signals;
+  sigfillset(&all_signals);
+  pthread_sigmask(SIG_BLOCK, &all_signals, &previous_signals);
+  io_thread_ = std::thread(&AsyncClient::RunIo, this);
+  pthread_sigmask(SIG_SETMASK, &previous_signals, nullptr);
+}
+
+void AsyncClient::Close() {
+  if (!io_thread_.joinable()) {
+    return;
+  }
+
+  is_closing_ = true;
+  poller_->Wakeup();
+  io_thread_.join();
+  // the server sees the connection closed even if the object lives on
+  socket_.Shutdown();
+}
+
+void AsyncClient::Subscribe(PushCallback callback) {
+  std::lock_guard lock(push_mutex_);
+  push_callback_ = std::move(callback);
+}
+
+void AsyncClient::Request(const std::string& message,
+                          ResponseCallback callback, uint16_t command_id,
+                          uint16_t flags) {
+  std::lock_guard lock(mutex_);
+  if (!is_connected_) {
+    throw ClientError("client isn't connected");
+  }
+
+  uint32_t request_id = MakeRequestId();
+  pending_[request_id] = std::move(callback);
+  Enqueue(message, FrameHeader{request_id, command_id, flags});
+}
+
+std::future<std::string> AsyncClient::Request(const std::string& message,
+                                              uint16_t command_id) {
+  auto promise = std::make_shared<std::promise<std::string>>();
+  auto future = promise->get_future();
+
+  Request(
+      message,
+      [promise](Status status, std::string response) {
+        if (status == Status::kOk) {
+          promise->set_value(std::move(response));
+        } else {
+          promise->set_exception(
+              std::make_exception_ptr(ClientError("connection closed")));
+        }
+      },
+      command_id);
+
+  return future;
+}
+
+void AsyncClient::Send(const std::string& message, uint16_t command_id,
+                       uint16_t flags) {
+  std::lock_guard lock(mutex_);
+  if (!is_connected_) {
+    throw ClientError("client isn't connected");
+  }
+
+  uint32_t request_id = kSendRequestIdBit | next_send_id_;
+  next_send_id_ = (next_send_id_ + 1) & ~kSendRequestIdBit;
+  Enqueue(message, FrameHeader{request_id, command_id, flags});
+}
+
+size_t AsyncClient::GetPendingCount() const {
+  std::lock_guard lock(mutex_);
+  return pending_.size();
+}
+
+bool AsyncClient::IsConnected() const noexcept {
+  std::lock_guard lock(mutex_);
+  return is_connected_;
+}
+
+uint32_t AsyncClient::MakeRequestId() {
+  // zero is left for messages pushed by the server
+  uint32_t request_id;
+  do {
+    request_id = next_request_id_;
+    next_request_id_ = next_request_id_ % (kSendRequestIdBit - 1) + 1;
+  } while (pending_.count(request_id) != 0);
+
+  return request_id;
+}
+
+void AsyncClient::Enqueue(const std::string& message,
+                          const FrameHeader& header) {
+  // header and payload go in one buffer, small requests take one write
+  auto data = std::make_shared<std::string>(
+      Socket::MakeHeader(message.size(), Framing::kBinary, header));
+  data->append(message);
+
+  bool is_queue_empty = outbound_.Empty();
+  outbound_.Push(std::move(data));
+  if (!is_queue_empty) {
+    // the background thread is already waiting for the socket to take more
+    return;
+  }
+
+  // most of the time the socket takes everything at once, so the background
+  // thread isn't woken up at all
+  Status status;
+  try {
+    status = outbound_.Flush(socket_);
+  } catch (const SocketError&) {
+    status = Status::kClosed;
+  }
+
+  if (status == Status::kClosed) {
+    // the background thread sees the connection closed and fails requests
+    socket_.Shutdown();
+    return;
+  }
+
+  if (status == Status::kTimeout && !is_write_requested_) {
+    is_write_requested_ = true;
+    poller_->Wakeup();
+  }
+}
+
+void AsyncClient::RunIo() {
+  FileDescriptorType file_descriptor = socket_.GetFileDescriptor();
+  std::vector<PollEvent> events;
+  bool is_writable_watched = false;
+  bool is_open = true;
+
+  while (is_open && !is_closing_) {
+    {
+      std::lock_guard lock(mutex_);
+      if (is_write_requested_ != is_writable_watched) {
+        is_writable_watched = is_write_requested_;
+        poller_->SetWritable(file_descriptor, is_writable_watched);
+      }
+    }
+
+    try {
+      poller_->Wait(events, -1);
+    } catch (const PollerError&) {
+      break;
+    }
+
+    for (const auto& event : events) {
+      if (event.file_descriptor != file_descriptor) {
+        continue;
+      }
+
+      if (event.is_writable && !FlushOutbound()) {
+        is_open = false;
+      }
+      if ((event.is_readable || event.is_closed) && !ReceiveResponses()) {
+        is_open = false;
+      }
+    }
+  }
+
+  std::unordered_map<uint32_t, ResponseCallback> pending;
+  {
+    std::lock_guard lock(mutex_);
+    is_connected_ = false;
+    pending.swap(pending_);
+  }
+  for (auto& [request_id, callback] : pending) {
+    callback(Status::kClosed, "");
+  }
+}
+
+bool AsyncClient::ReceiveResponses() {
+  std::string message;
+  FrameHeader header;
+  try {
+    if (socket_.ReceiveAvailable() == Status::kClosed) {
+      return false;
+    }
+
+    while (socket_.ExtractMessage(message, header)) {
+      // a reply to a send, e.g. an error, has nobody waiting for it either
+      if (header.request_id == 0 || header.request_id & kSendRequestIdBit) {
+        std::lock_guard lock(push_mutex_);
+        if (push_callback_) {
+          push_callback_(message, header);
+        }
+        continue;
+      }
+
+      ResponseCallback callback;
+      {
+        std::lock_guard lock(mutex_);
+        auto found = pending_.find(header.request_id);
+        if (found != pending_.end()) {
+          callback = std::move(found->second);
+          pending_.erase(found);
+        }
+      }
+      // responses nobody waits for are dropped
+      if (callback) {
+        callback(Status::kOk, std::move(message));
+      }
+    }
+  } catch (const SocketError&) {
+    // malformed frame
+    return false;
+  }
+
+  return true;
+}
+
+bool AsyncClient::FlushOutbound() {
+  std::lock_guard lock(mutex_);
+  Status status;
+  try {
+    status = outbound_.Flush(socket_);
+  } catch (const SocketError&) {
+    status = Status::kClosed;
+  }
+
+  if (status == Status::kOk) {
+    is_write_requested_ = false;
+  }
+
+  return status != Status::kClosed;
+}
+
+}  // namespace net
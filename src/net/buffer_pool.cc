@@ -0,0 +1,99 @@
+#include "include/net/buffer_pool.h"
+
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace net {
+
+namespace {
+
+constexpr size_t kClassesCount = [] {
+  size_t count = 0;
+  for (size_t size = BufferPool::kMinBufferSize;
+       size <= BufferPool::kMaxBufferSize; size *= 2) {
+    ++count;
+  }
+  return count;
+}();
+
+}  // namespace
+
+BufferPool::BufferPool() : mutex_(), free_lists_(kClassesCount) {}
+
+std::string BufferPool::Acquire(size_t size) {
+  std::string buffer;
+  if (size > kMaxBufferSize) {
+    buffer.reserve(size);
+    return buffer;
+  }
+
+  size_t size_class = GetAcquireClass(size);
+  {
+    std::lock_guard lock(mutex_);
+    auto& free_list = free_lists_[size_class];
+    if (!free_list.empty()) {
+      buffer = std::move(free_list.back());
+      free_list.pop_back();
+      return buffer;
+    }
+  }
+
+  buffer.reserve(kMinBufferSize << size_class);
+  return buffer;
+}
+
+void BufferPool::Release(std::string buffer) {
+  std::lock_guard lock(mutex_);
+  ReleaseLocked(buffer);
+}
+
+void BufferPool::Release(std::vector<std::string>& buffers) {
+  {
+    std::lock_guard lock(mutex_);
+    for (auto& buffer : buffers) {
+      ReleaseLocked(buffer);
+    }
+  }
+  buffers.clear();
+}
+
+size_t BufferPool::GetAcquireClass(size_t size) noexcept {
+  size_t size_class = 0;
+  while ((kMinBufferSize << size_class) < size) {
+    ++size_class;
+  }
+  return size_class;
+}
+
+size_t BufferPool::GetReleaseClass(size_t capacity) noexcept {
+  size_t size_class = 0;
+  while (size_class + 1 < kClassesCount &&
+         (kMinBufferSize << (size_class + 1)) <= capacity) {
+    ++size_class;
+  }
+  return size_class;
+}
+
+void BufferPool::ReleaseLocked(std::string& buffer) {
+  // buffers grown by a huge message aren't worth keeping
+  if (buffer.capacity() < kMinBufferSize ||
+      buffer.capacity() > kMaxBufferSize * 2) {
+    return;
+  }
+
+  auto& free_list = free_lists_[GetReleaseClass(buffer.capacity())];
+  if (free_list.size() < kMaxBuffersPerClass) {
+    buffer.clear();
+    try {
+      free_list.push_back(std::move(buffer));
+    } catch (const std::bad_alloc&) {
+      // the buffer is just freed then
+    }
+  }
+}
+
+}  // namespace net
@@ -1,7 +1,10 @@
 #include "include/net/client.h"
 
+#include <sys/socket.h>
+
 #include <stdexcept>
 
+#include "include/net/frame.h"
 #include "include/net/socket.h"
 
 namespace net {
@@ -14,12 +17,28 @@ Client::Client(AddressFamilyType address_family, SocketType socket_type,
     : socket_(std::nullopt, address_family, socket_type, protocol),
       is_connected_(false) {}
 
-void Client::Connect(const Address& address) {
+void Client::Connect(const Address& address, Framing framing) {
   if (is_connected_) {
     throw ClientError("this client is already connected");
   }
 
   socket_.Connect(address);
+  if (socket_.GetAddressFamily() == AF_INET &&
+      socket_.GetSocketType() == SOCK_STREAM) {
+    socket_.SetNoDelay();
+  }
+
+  if (framing == Framing::kBinary) {
+    Status status;
+    try {
+      status = socket_.NegotiateFraming();
+    } catch (const SocketError&) {
+      status = Status::kClosed;
+    }
+    if (status != Status::kOk) {
+      throw ClientError("can't negotiate binary framing");
+    }
+  }
   is_connected_ = true;
 }
 
@@ -31,6 +50,15 @@ Status Client::Send(const std::string& message, int timeout_msec) {
   return socket_.Send(message, timeout_msec);
 }
 
+Status Client::Send(const std::string& message, const FrameHeader& header,
+                    int timeout_msec) {
+  if (!is_connected_) {
+    throw ClientError("client isn't connected");
+  }
+
+  return socket_.Send(message, header, timeout_msec);
+}
+
 Response<std::string> Client::Receive(int timeout_msec) {
   if (!is_connected_) {
     throw ClientError("client isn't connected");
@@ -39,6 +67,17 @@ Response<std::string> Client::Receive(int timeout_msec) {
   return socket_.Receive(timeout_msec);
 }
 
+Status Client::Receive(std::string& message, FrameHeader& header,
+                       int timeout_msec) {
+  if (!is_connected_) {
+    throw ClientError("client isn't connected");
+  }
+
+  return socket_.Receive(message, header, timeout_msec);
+}
+
+Framing Client::GetFraming() const noexcept { return socket_.GetFraming(); }
+
 bool Client::IsConnected() const noexcept { return is_connected_; }
 
 }  // namespace net
@@ -0,0 +1,53 @@
+#include "include/net/message.h"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace net {
+
+Message::Message(const char* data) : Message(std::string(data)) {}
+
+Message::Message(std::string data) : parts_() {
+  if (!data.empty()) {
+    parts_.push_back(std::make_shared<const std::string>(std::move(data)));
+  }
+}
+
+Message::Message(std::vector<std::string> parts) : parts_() {
+  parts_.reserve(parts.size());
+  for (auto& part : parts) {
+    parts_.push_back(std::make_shared<const std::string>(std::move(part)));
+  }
+}
+
+Message::Message(Part part) : parts_() {
+  if (part && !part->empty()) {
+    parts_.push_back(std::move(part));
+  }
+}
+
+Message::Message(std::vector<Part> parts) : parts_(std::move(parts)) {}
+
+bool Message::Empty() const noexcept { return Size() == 0; }
+
+size_t Message::Size() const noexcept {
+  size_t size = 0;
+  for (const auto& part : parts_) {
+    size += part->size();
+  }
+
+  return size;
+}
+
+const std::vector<Message::Part>& Message::GetParts() const noexcept {
+  return parts_;
+}
+
+std::vector<Message::Part> Message::TakeParts() noexcept {
+  return std::move(parts_);
+}
+
+}  // namespace net
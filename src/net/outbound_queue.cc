@@ -0,0 +1,88 @@
+#include "include/net/outbound_queue.h"
+
+#include <sys/uio.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "include/net/socket.h"
+
+namespace net {
+
+OutboundQueue::OutboundQueue() : chunks_(), front_offset_(0), size_(0) {}
+
+void OutboundQueue::Push(std::shared_ptr<const std::string> data) {
+  if (data->empty()) {
+    return;
+  }
+
+  size_ += data->size();
+  chunks_.push_back(std::move(data));
+}
+
+size_t OutboundQueue::Size() const noexcept { return size_; }
+
+bool OutboundQueue::Empty() const noexcept { return size_ == 0; }
+
+Status OutboundQueue::Flush(Socket& socket) {
+  struct iovec buffers[kMaxBuffersPerWrite];
+
+  while (!chunks_.empty()) {
+    // gathers as many chunks as possible into a single write
+    size_t count = GatherBuffers(buffers);
+
+    auto response = socket.SendAvailable(buffers, count);
+    if (response.status != Status::kOk) {
+      return response.status;
+    }
+
+    size_t offered = 0;
+    for (size_t i = 0; i < count; ++i) {
+      offered += buffers[i].iov_len;
+    }
+
+    Consume(response.data);
+    if (response.data != offered) {
+      // the socket is full
+      return Status::kTimeout;
+    }
+  }
+
+  return Status::kOk;
+}
+
+size_t OutboundQueue::Gather(
+    struct iovec* buffers,
+    std::vector<std::shared_ptr<const std::string>>& owners) const {
+  size_t count = GatherBuffers(buffers);
+  owners.insert(owners.end(), chunks_.begin(), chunks_.begin() + count);
+  return count;
+}
+
+void OutboundQueue::Consume(size_t size) noexcept {
+  size = std::min(size, size_);
+  size_ -= size;
+  while (size != 0 && size >= chunks_.front()->size() - front_offset_) {
+    size -= chunks_.front()->size() - front_offset_;
+    chunks_.pop_front();
+    front_offset_ = 0;
+  }
+  front_offset_ += size;
+}
+
+size_t OutboundQueue::GatherBuffers(struct iovec* buffers) const noexcept {
+  size_t count = 0;
+  for (auto i = chunks_.begin();
+       i != chunks_.end() && count != kMaxBuffersPerWrite; ++i, ++count) {
+    size_t offset = count == 0 ? front_offset_ : 0;
+    buffers[count].iov_base = const_cast<char*>((*i)->data() + offset);
+    buffers[count].iov_len = (*i)->size() - offset;
+  }
+  return count;
+}
+
+}  // namespace net
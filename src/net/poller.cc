@@ -0,0 +1,745 @@
+#include "include/net/poller.h"
+
+#include <errno.h>
+#include <linux/io_uring.h>
+#include <linux/time_types.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "include/net/socket.h"
+
+namespace net {
+
+PollerError::PollerError(const std::string& message)
+    : std::runtime_error(message) {}
+
+std::unique_ptr<Poller> Poller::Create(PollerType type) {
+  switch (type) {
+    case PollerType::kPoll:
+      return std::make_unique<PollPoller>();
+    case PollerType::kEpoll:
+      return std::make_unique<EpollPoller>();
+    case PollerType::kUring:
+      try {
+        return std::make_unique<UringPoller>();
+      } catch (const PollerError&) {
+        return std::make_unique<EpollPoller>();
+      }
+  }
+
+  throw PollerError("unknown poller type");
+}
+
+Poller::Poller()
+    : wakeup_file_descriptor_(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) {
+  if (wakeup_file_descriptor_ < 0) {
+    throw PollerError("can't create wakeup descriptor");
+  }
+}
+
+Poller::~Poller() { close(wakeup_file_descriptor_); }
+
+void Poller::Wakeup() noexcept {
+  uint64_t value = 1;
+  if (write(wakeup_file_descriptor_, &value, sizeof(value)) < 0) {
+    // the counter is saturated, so a wakeup is pending anyway
+  }
+}
+
+bool Poller::ConsumeWakeup(FileDescriptorType file_descriptor) noexcept {
+  if (file_descriptor != wakeup_file_descriptor_) {
+    return false;
+  }
+
+  uint64_t value;
+  if (read(wakeup_file_descriptor_, &value, sizeof(value)) < 0) {
+    // already drained by a previous wait
+  }
+  return true;
+}
+
+bool Poller::IsDoingIo() const noexcept { return false; }
+
+void Poller::AddListener(FileDescriptorType) {
+  throw PollerError("poller doesn't do i/o");
+}
+
+void Poller::AddConnection(FileDescriptorType) {
+  throw PollerError("poller doesn't do i/o");
+}
+
+void Poller::SetReceiving(FileDescriptorType, bool) {
+  throw PollerError("poller doesn't do i/o");
+}
+
+void Poller::Send(FileDescriptorType, const struct iovec*, size_t,
+                  std::vector<std::shared_ptr<const std::string>>) {
+  throw PollerError("poller doesn't do i/o");
+}
+
+PollPoller::PollPoller() { Add(wakeup_file_descriptor_); }
+
+void PollPoller::Add(FileDescriptorType file_descriptor) {
+  if (indices_.count(file_descriptor) != 0) {
+    throw PollerError("descriptor is already registered");
+  }
+
+  struct pollfd poll_file_descriptor {};
+  poll_file_descriptor.fd = file_descriptor;
+  poll_file_descriptor.events = POLLIN;
+
+  indices_[file_descriptor] = descriptors_.size();
+  descriptors_.push_back(poll_file_descriptor);
+}
+
+void PollPoller::Remove(FileDescriptorType file_descriptor) {
+  auto pos = indices_.find(file_descriptor);
+  if (pos == indices_.end()) {
+    return;
+  }
+
+  // swap with the last one to keep removal O(1)
+  size_t index = pos->second;
+  indices_.erase(pos);
+  if (index != descriptors_.size() - 1) {
+    descriptors_[index] = descriptors_.back();
+    indices_[descriptors_[index].fd] = index;
+  }
+  descriptors_.pop_back();
+}
+
+void PollPoller::SetWritable(FileDescriptorType file_descriptor,
+                             bool is_writable) {
+  auto pos = indices_.find(file_descriptor);
+  if (pos == indices_.end()) {
+    throw PollerError("descriptor isn't registered");
+  }
+
+  descriptors_[pos->second].events = is_writable ? POLLIN | POLLOUT : POLLIN;
+}
+
+size_t PollPoller::Wait(std::vector<PollEvent>& events, int timeout_msec) {
+  events.clear();
+
+  int status_code =
+      poll(descriptors_.data(), descriptors_.size(), timeout_msec);
+  if (status_code < 0) {
+    if (errno == EINTR) {
+      return 0;
+    }
+    throw PollerError("error while polling");
+  }
+
+  for (auto i = descriptors_.begin();
+       i != descriptors_.end() && status_code != 0; ++i) {
+    if (i->revents == 0) {
+      continue;
+    }
+
+    --status_code;
+    if (!ConsumeWakeup(i->fd)) {
+      events.push_back(PollEvent{i->fd, (i->revents & POLLIN) != 0,
+                                 (i->revents & POLLOUT) != 0,
+                                 (i->revents & (POLLHUP | POLLERR)) != 0});
+    }
+    i->revents = 0;
+  }
+
+  return events.size();
+}
+
+EpollPoller::EpollPoller()
+    : epoll_file_descriptor_(epoll_create1(EPOLL_CLOEXEC)),
+      ready_(kMaxEventsPerWait) {
+  if (epoll_file_descriptor_ < 0) {
+    throw PollerError("can't create epoll instance");
+  }
+
+  Add(wakeup_file_descriptor_);
+}
+
+EpollPoller::~EpollPoller() { close(epoll_file_descriptor_); }
+
+void EpollPoller::Add(FileDescriptorType file_descriptor) {
+  struct epoll_event event {};
+  event.events = EPOLLIN;
+  event.data.fd = file_descriptor;
+
+  int status_code = epoll_ctl(epoll_file_descriptor_, EPOLL_CTL_ADD,
+                              file_descriptor, &event);
+  if (status_code < 0) {
+    throw PollerError("can't register descriptor in epoll");
+  }
+}
+
+void EpollPoller::Remove(FileDescriptorType file_descriptor) {
+  // descriptor may be already closed and therefore gone from the interest
+  // list, so errors are ignored here
+  epoll_ctl(epoll_file_descriptor_, EPOLL_CTL_DEL, file_descriptor, nullptr);
+}
+
+void EpollPoller::SetWritable(FileDescriptorType file_descriptor,
+                              bool is_writable) {
+  struct epoll_event event {};
+  event.events = is_writable ? EPOLLIN | EPOLLOUT : EPOLLIN;
+  event.data.fd = file_descriptor;
+
+  int status_code = epoll_ctl(epoll_file_descriptor_, EPOLL_CTL_MOD,
+                              file_descriptor, &event);
+  if (status_code < 0) {
+    throw PollerError("can't modify descriptor in epoll");
+  }
+}
+
+size_t EpollPoller::Wait(std::vector<PollEvent>& events, int timeout_msec) {
+  events.clear();
+
+  int status_code = epoll_wait(epoll_file_descriptor_, ready_.data(),
+                               ready_.size(), timeout_msec);
+  if (status_code < 0) {
+    if (errno == EINTR) {
+      return 0;
+    }
+    throw PollerError("error while waiting on epoll");
+  }
+
+  for (int i = 0; i < status_code; ++i) {
+    if (ConsumeWakeup(ready_[i].data.fd)) {
+      continue;
+    }
+
+    events.push_back(
+        PollEvent{ready_[i].data.fd, (ready_[i].events & EPOLLIN) != 0,
+                  (ready_[i].events & EPOLLOUT) != 0,
+                  (ready_[i].events & (EPOLLHUP | EPOLLERR)) != 0});
+  }
+
+  return events.size();
+}
+
+namespace {
+
+int IoUringSetup(unsigned entries, struct io_uring_params* params) {
+  return syscall(__NR_io_uring_setup, entries, params);
+}
+
+int IoUringEnter(int ring_file_descriptor, unsigned to_submit,
+                 unsigned min_complete, unsigned flags, const void* argument,
+                 size_t argument_size) {
+  return syscall(__NR_io_uring_enter, ring_file_descriptor, to_submit,
+                 min_complete, flags, argument, argument_size);
+}
+
+}  // namespace
+
+UringPoller::UringPoller()
+    : ring_file_descriptor_(-1),
+      rings_(MAP_FAILED),
+      rings_size_(0),
+      submission_entries_(static_cast<struct io_uring_sqe*>(MAP_FAILED)),
+      submission_entries_size_(0),
+      submission_head_(nullptr),
+      submission_tail_(nullptr),
+      local_submission_tail_(0),
+      submission_mask_(0),
+      submission_entries_count_(0),
+      submission_array_(nullptr),
+      completion_head_(nullptr),
+      completion_tail_(nullptr),
+      completion_mask_(0),
+      completion_entries_(nullptr),
+      receive_buffers_(nullptr),
+      used_receive_buffers_(),
+      next_generation_(0),
+      registrations_(),
+      disarmed_(),
+      sends_() {
+  struct io_uring_params params {};
+  ring_file_descriptor_ = IoUringSetup(kRingEntries, &params);
+  if (ring_file_descriptor_ < 0) {
+    throw PollerError("io_uring isn't supported");
+  }
+
+  // timeouts are passed to the wait itself, rings are mapped at once
+  if (!(params.features & IORING_FEAT_EXT_ARG) ||
+      !(params.features & IORING_FEAT_SINGLE_MMAP)) {
+    close(ring_file_descriptor_);
+    throw PollerError("io_uring lacks required features");
+  }
+
+  rings_size_ = std::max(
+      params.sq_off.array + params.sq_entries * sizeof(unsigned),
+      params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe));
+  rings_ = mmap(nullptr, rings_size_, PROT_READ | PROT_WRITE,
+                MAP_SHARED | MAP_POPULATE, ring_file_descriptor_,
+                IORING_OFF_SQ_RING);
+
+  submission_entries_size_ = params.sq_entries * sizeof(struct io_uring_sqe);
+  submission_entries_ = static_cast<struct io_uring_sqe*>(
+      mmap(nullptr, submission_entries_size_, PROT_READ | PROT_WRITE,
+           MAP_SHARED | MAP_POPULATE, ring_file_descriptor_,
+           IORING_OFF_SQES));
+
+  if (rings_ == MAP_FAILED || submission_entries_ == MAP_FAILED) {
+    Release();
+    throw PollerError("can't map io_uring rings");
+  }
+
+  char* rings = static_cast<char*>(rings_);
+  submission_head_ = reinterpret_cast<unsigned*>(rings + params.sq_off.head);
+  submission_tail_ = reinterpret_cast<unsigned*>(rings + params.sq_off.tail);
+  local_submission_tail_ = *submission_tail_;
+  submission_mask_ =
+      *reinterpret_cast<unsigned*>(rings + params.sq_off.ring_mask);
+  submission_entries_count_ =
+      *reinterpret_cast<unsigned*>(rings + params.sq_off.ring_entries);
+  submission_array_ = reinterpret_cast<unsigned*>(rings + params.sq_off.array);
+
+  completion_head_ = reinterpret_cast<unsigned*>(rings + params.cq_off.head);
+  completion_tail_ = reinterpret_cast<unsigned*>(rings + params.cq_off.tail);
+  completion_mask_ =
+      *reinterpret_cast<unsigned*>(rings + params.cq_off.ring_mask);
+  completion_entries_ =
+      reinterpret_cast<struct io_uring_cqe*>(rings + params.cq_off.cqes);
+
+  try {
+    // without them only readiness is polled
+    SetUpReceiveBuffers();
+    Add(wakeup_file_descriptor_);
+  } catch (...) {
+    Release();
+    throw;
+  }
+}
+
+UringPoller::~UringPoller() { Release(); }
+
+void UringPoller::Release() noexcept {
+  if (submission_entries_ != MAP_FAILED) {
+    munmap(submission_entries_, submission_entries_size_);
+    submission_entries_ = static_cast<struct io_uring_sqe*>(MAP_FAILED);
+  }
+  if (rings_ != MAP_FAILED) {
+    munmap(rings_, rings_size_);
+    rings_ = MAP_FAILED;
+  }
+  if (ring_file_descriptor_ >= 0) {
+    close(ring_file_descriptor_);
+    ring_file_descriptor_ = -1;
+  }
+  // the ring is gone, so nothing is received into the buffers anymore
+  if (receive_buffers_ != nullptr) {
+    munmap(receive_buffers_, kReceiveBuffersCount * kReceiveBufferSize);
+    receive_buffers_ = nullptr;
+  }
+}
+
+bool UringPoller::SetUpReceiveBuffers() {
+  void* buffers = mmap(nullptr, kReceiveBuffersCount * kReceiveBufferSize,
+                       PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+  if (buffers == MAP_FAILED) {
+    return false;
+  }
+  receive_buffers_ = static_cast<char*>(buffers);
+
+  // the only submission so far, its completion tells if they are supported
+  ProvideReceiveBuffers(0, kReceiveBuffersCount);
+  unsigned head = *completion_head_;
+  do {
+    Enter(1, -1);
+  } while (head == __atomic_load_n(completion_tail_, __ATOMIC_ACQUIRE));
+
+  int status_code = completion_entries_[head & completion_mask_].res;
+  __atomic_store_n(completion_head_, head + 1, __ATOMIC_RELEASE);
+
+  if (status_code < 0) {
+    munmap(receive_buffers_, kReceiveBuffersCount * kReceiveBufferSize);
+    receive_buffers_ = nullptr;
+    return false;
+  }
+  return true;
+}
+
+void UringPoller::ProvideReceiveBuffers(uint16_t first_id, uint16_t count) {
+  struct io_uring_sqe* entry = GetSubmissionEntry();
+  entry->opcode = IORING_OP_PROVIDE_BUFFERS;
+  entry->fd = count;
+  entry->addr = reinterpret_cast<uint64_t>(receive_buffers_ +
+                                           first_id * kReceiveBufferSize);
+  entry->len = kReceiveBufferSize;
+  entry->off = first_id;
+  entry->buf_group = kReceiveBufferGroup;
+  entry->user_data = kIgnoredUserData;
+}
+
+void UringPoller::Add(FileDescriptorType file_descriptor) {
+  Register(file_descriptor, Operation::kPoll);
+}
+
+void UringPoller::Remove(FileDescriptorType file_descriptor) {
+  auto pos = registrations_.find(file_descriptor);
+  if (pos == registrations_.end()) {
+    return;
+  }
+
+  // completions of whatever is in flight are told apart by generation
+  const Registration& registration = pos->second;
+  if (registration.is_armed) {
+    SubmitCancel(
+        MakeUserData(file_descriptor, registration.generation, false));
+  }
+  if (registration.is_sending) {
+    SubmitCancel(MakeUserData(file_descriptor, registration.generation, true));
+  }
+  registrations_.erase(pos);
+}
+
+void UringPoller::SetWritable(FileDescriptorType file_descriptor,
+                              bool is_writable) {
+  Registration& registration = Find(file_descriptor);
+  if (registration.operation != Operation::kPoll) {
+    throw PollerError("descriptor isn't polled");
+  }
+  if (registration.is_writable == is_writable) {
+    return;
+  }
+
+  // the armed poll is replaced, its completion is told apart by generation
+  registration.is_writable = is_writable;
+  if (registration.is_armed) {
+    SubmitCancel(
+        MakeUserData(file_descriptor, registration.generation, false));
+    registration.generation = next_generation_++;
+    registration.is_armed = false;
+    disarmed_.push_back(file_descriptor);
+  }
+}
+
+size_t UringPoller::Wait(std::vector<PollEvent>& events, int timeout_msec) {
+  events.clear();
+
+  // bytes handed over by the previous Wait are processed by now, runs of
+  // consecutive buffers go back with a single submission; they are
+  // submitted before the receives below
+  std::sort(used_receive_buffers_.begin(), used_receive_buffers_.end());
+  for (size_t i = 0; i < used_receive_buffers_.size();) {
+    size_t run = 1;
+    while (i + run < used_receive_buffers_.size() &&
+           used_receive_buffers_[i + run] == used_receive_buffers_[i] + run) {
+      ++run;
+    }
+    ProvideReceiveBuffers(used_receive_buffers_[i],
+                          static_cast<uint16_t>(run));
+    i += run;
+  }
+  used_receive_buffers_.clear();
+
+  for (auto file_descriptor : disarmed_) {
+    auto pos = registrations_.find(file_descriptor);
+    if (pos != registrations_.end() && !pos->second.is_armed) {
+      Arm(file_descriptor, pos->second);
+    }
+  }
+  disarmed_.clear();
+
+  unsigned head = *completion_head_;
+  bool has_completions =
+      head != __atomic_load_n(completion_tail_, __ATOMIC_ACQUIRE);
+
+  // submissions of this iteration go together with the wait
+  Enter(has_completions || timeout_msec == 0 ? 0 : 1, timeout_msec);
+
+  unsigned tail = __atomic_load_n(completion_tail_, __ATOMIC_ACQUIRE);
+  for (; head != tail; ++head) {
+    const struct io_uring_cqe& completion =
+        completion_entries_[head & completion_mask_];
+    if (completion.user_data == kIgnoredUserData) {
+      continue;
+    }
+
+    const char* received = nullptr;
+    if (completion.flags & IORING_CQE_F_BUFFER) {
+      // goes back even if the receive is stale
+      auto buffer_id =
+          static_cast<uint16_t>(completion.flags >> IORING_CQE_BUFFER_SHIFT);
+      used_receive_buffers_.push_back(buffer_id);
+      received = receive_buffers_ + buffer_id * kReceiveBufferSize;
+    }
+
+    auto file_descriptor =
+        static_cast<FileDescriptorType>(completion.user_data & 0xffff'ffff);
+    bool is_send = (completion.user_data >> 32) & 1;
+    if (is_send) {
+      // buffers of the send may be released now
+      sends_.erase(completion.user_data);
+    }
+
+    auto pos = registrations_.find(file_descriptor);
+    if (pos == registrations_.end() ||
+        MakeUserData(file_descriptor, pos->second.generation, is_send) !=
+            completion.user_data) {
+      // completion of a removed or replaced submission
+      continue;
+    }
+
+    Registration& registration = pos->second;
+    if (is_send) {
+      registration.is_sending = false;
+      events.push_back(PollEvent{
+          file_descriptor, false, true, completion.res < 0, -1, {},
+          static_cast<size_t>(std::max(completion.res, 0))});
+      continue;
+    }
+
+    registration.is_armed = false;
+    disarmed_.push_back(file_descriptor);
+
+    if (ConsumeWakeup(file_descriptor)) {
+      continue;
+    }
+
+    switch (registration.operation) {
+      case Operation::kPoll:
+        if (completion.res < 0) {
+          events.push_back(PollEvent{file_descriptor, false, false, true});
+        } else {
+          events.push_back(
+              PollEvent{file_descriptor, (completion.res & POLLIN) != 0,
+                        (completion.res & POLLOUT) != 0,
+                        (completion.res & (POLLHUP | POLLERR)) != 0});
+        }
+        break;
+      case Operation::kAccept:
+        // failed accepts, e.g. of connections reset before, are retried
+        if (completion.res >= 0) {
+          events.push_back(
+              PollEvent{file_descriptor, true, false, false, completion.res});
+        }
+        break;
+      case Operation::kReceive:
+        if (completion.res == -ENOBUFS) {
+          // retried once the buffers are back
+          break;
+        }
+        if (completion.res > 0 && received != nullptr) {
+          events.push_back(PollEvent{
+              file_descriptor, true, false, false, -1,
+              std::string_view(received, completion.res)});
+        } else {
+          // end of stream or an error
+          events.push_back(PollEvent{file_descriptor, false, false, true});
+        }
+        break;
+    }
+  }
+  __atomic_store_n(completion_head_, head, __ATOMIC_RELEASE);
+
+  return events.size();
+}
+
+bool UringPoller::IsDoingIo() const noexcept {
+  return receive_buffers_ != nullptr;
+}
+
+void UringPoller::AddListener(FileDescriptorType file_descriptor) {
+  if (!IsDoingIo()) {
+    throw PollerError("poller doesn't do i/o");
+  }
+  Register(file_descriptor, Operation::kAccept);
+}
+
+void UringPoller::AddConnection(FileDescriptorType file_descriptor) {
+  if (!IsDoingIo()) {
+    throw PollerError("poller doesn't do i/o");
+  }
+  Register(file_descriptor, Operation::kReceive);
+}
+
+void UringPoller::SetReceiving(FileDescriptorType file_descriptor,
+                               bool is_receiving) {
+  Registration& registration = Find(file_descriptor);
+  if (registration.operation != Operation::kReceive) {
+    throw PollerError("descriptor isn't a connection");
+  }
+  if (registration.is_receiving == is_receiving) {
+    return;
+  }
+
+  // a receive in flight is left to complete, only the next one is held back
+  registration.is_receiving = is_receiving;
+  if (is_receiving && !registration.is_armed) {
+    disarmed_.push_back(file_descriptor);
+  }
+}
+
+void UringPoller::Send(
+    FileDescriptorType file_descriptor, const struct iovec* buffers,
+    size_t count, std::vector<std::shared_ptr<const std::string>> owners) {
+  Registration& registration = Find(file_descriptor);
+  if (registration.operation != Operation::kReceive) {
+    throw PollerError("descriptor isn't a connection");
+  }
+  if (registration.is_sending) {
+    throw PollerError("send is in flight already");
+  }
+
+  struct io_uring_sqe* entry = GetSubmissionEntry();
+
+  uint64_t user_data =
+      MakeUserData(file_descriptor, registration.generation, true);
+  PendingSend& send = sends_[user_data];
+  send.buffers.assign(buffers, buffers + count);
+  send.owners = std::move(owners);
+  send.message = {};
+  send.message.msg_iov = send.buffers.data();
+  send.message.msg_iovlen = send.buffers.size();
+
+  entry->opcode = IORING_OP_SENDMSG;
+  entry->fd = file_descriptor;
+  entry->addr = reinterpret_cast<uint64_t>(&send.message);
+  entry->len = 1;
+  entry->msg_flags = MSG_NOSIGNAL;
+  entry->user_data = user_data;
+
+  registration.is_sending = true;
+}
+
+uint64_t UringPoller::MakeUserData(FileDescriptorType file_descriptor,
+                                   uint32_t generation,
+                                   bool is_send) noexcept {
+  return (uint64_t((generation << 1) | uint32_t(is_send)) << 32) |
+         uint32_t(file_descriptor);
+}
+
+UringPoller::Registration& UringPoller::Register(
+    FileDescriptorType file_descriptor, Operation operation) {
+  if (registrations_.count(file_descriptor) != 0) {
+    throw PollerError("descriptor is already registered");
+  }
+
+  Registration& registration = registrations_[file_descriptor];
+  registration =
+      Registration{next_generation_++, operation, false, true, false, false};
+  disarmed_.push_back(file_descriptor);
+  return registration;
+}
+
+UringPoller::Registration& UringPoller::Find(
+    FileDescriptorType file_descriptor) {
+  auto pos = registrations_.find(file_descriptor);
+  if (pos == registrations_.end()) {
+    throw PollerError("descriptor isn't registered");
+  }
+  return pos->second;
+}
+
+struct io_uring_sqe* UringPoller::GetSubmissionEntry() {
+  unsigned head = __atomic_load_n(submission_head_, __ATOMIC_ACQUIRE);
+  if (local_submission_tail_ - head == submission_entries_count_) {
+    // ring is full - submitting without waiting
+    Enter(0, 0);
+    head = __atomic_load_n(submission_head_, __ATOMIC_ACQUIRE);
+    if (local_submission_tail_ - head == submission_entries_count_) {
+      throw PollerError("io_uring submission queue is full");
+    }
+  }
+
+  unsigned index = local_submission_tail_++ & submission_mask_;
+  submission_array_[index] = index;
+
+  struct io_uring_sqe* entry = &submission_entries_[index];
+  std::memset(entry, 0, sizeof(*entry));
+  return entry;
+}
+
+void UringPoller::Arm(FileDescriptorType file_descriptor,
+                      Registration& registration) {
+  if (registration.operation == Operation::kReceive &&
+      !registration.is_receiving) {
+    return;
+  }
+
+  struct io_uring_sqe* entry = GetSubmissionEntry();
+  entry->fd = file_descriptor;
+  entry->user_data =
+      MakeUserData(file_descriptor, registration.generation, false);
+
+  switch (registration.operation) {
+    case Operation::kPoll:
+      entry->opcode = IORING_OP_POLL_ADD;
+      entry->poll32_events =
+          registration.is_writable ? POLLIN | POLLOUT : POLLIN;
+      break;
+    case Operation::kAccept:
+      entry->opcode = IORING_OP_ACCEPT;
+      entry->accept_flags = SOCK_NONBLOCK;
+      break;
+    case Operation::kReceive:
+      // the kernel picks a buffer once the bytes arrive, idle connections
+      // don't hold any
+      entry->opcode = IORING_OP_RECV;
+      entry->len = kReceiveBufferSize;
+      entry->flags = IOSQE_BUFFER_SELECT;
+      entry->buf_group = kReceiveBufferGroup;
+      break;
+  }
+
+  registration.is_armed = true;
+}
+
+void UringPoller::SubmitCancel(uint64_t user_data) {
+  struct io_uring_sqe* entry = GetSubmissionEntry();
+  entry->opcode = IORING_OP_ASYNC_CANCEL;
+  entry->fd = -1;
+  entry->addr = user_data;
+  entry->user_data = kIgnoredUserData;
+}
+
+int UringPoller::Enter(unsigned min_complete, int timeout_msec) {
+  __atomic_store_n(submission_tail_, local_submission_tail_, __ATOMIC_RELEASE);
+  unsigned to_submit =
+      local_submission_tail_ - __atomic_load_n(submission_head_,
+                                               __ATOMIC_ACQUIRE);
+
+  struct __kernel_timespec timeout {};
+  struct io_uring_getevents_arg argument {};
+  if (timeout_msec > 0) {
+    timeout.tv_sec = timeout_msec / 1'000;
+    timeout.tv_nsec = (timeout_msec % 1'000) * 1'000'000LL;
+    argument.ts = reinterpret_cast<uint64_t>(&timeout);
+  }
+
+  unsigned flags = IORING_ENTER_EXT_ARG;
+  if (min_complete != 0) {
+    flags |= IORING_ENTER_GETEVENTS;
+  }
+
+  int status_code = IoUringEnter(ring_file_descriptor_, to_submit,
+                                 min_complete, flags, &argument,
+                                 sizeof(argument));
+  if (status_code < 0) {
+    if (errno == EINTR || errno == ETIME || errno == EBUSY ||
+        errno == EAGAIN) {
+      return 0;
+    }
+    throw PollerError("error while entering io_uring");
+  }
+
+  return status_code;
+}
+
+}  // namespace net
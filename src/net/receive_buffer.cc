@@ -0,0 +1,63 @@
+#include "include/net/receive_buffer.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+namespace net {
+
+ReceiveBuffer::ReceiveBuffer(size_t capacity)
+    : initial_capacity_(capacity), buffer_(capacity), begin_(0), end_(0) {}
+
+std::string_view ReceiveBuffer::Data() const noexcept {
+  return std::string_view(buffer_.data() + begin_, end_ - begin_);
+}
+
+size_t ReceiveBuffer::Size() const noexcept { return end_ - begin_; }
+
+bool ReceiveBuffer::Empty() const noexcept { return begin_ == end_; }
+
+void ReceiveBuffer::Consume(size_t size) noexcept {
+  begin_ += std::min(size, Size());
+  if (begin_ != end_) {
+    return;
+  }
+
+  begin_ = end_ = 0;
+  if (buffer_.size() > initial_capacity_ * 4) {
+    // don't keep memory of a single huge message forever
+    buffer_.resize(initial_capacity_);
+    buffer_.shrink_to_fit();
+  }
+}
+
+char* ReceiveBuffer::PrepareWrite(size_t min_size) {
+  if (WritableSize() >= min_size) {
+    return buffer_.data() + end_;
+  }
+
+  size_t size = Size();
+  if (begin_ != 0) {
+    std::memmove(buffer_.data(), buffer_.data() + begin_, size);
+    begin_ = 0;
+    end_ = size;
+  }
+
+  if (WritableSize() < min_size) {
+    buffer_.resize(std::max(buffer_.size() * 2, size + min_size));
+  }
+
+  return buffer_.data() + end_;
+}
+
+size_t ReceiveBuffer::WritableSize() const noexcept {
+  return buffer_.size() - end_;
+}
+
+void ReceiveBuffer::Commit(size_t size) noexcept {
+  end_ += std::min(size, WritableSize());
+}
+
+}  // namespace net
@@ -1,134 +1,1139 @@
 #include "include/net/server.h"
 
-#include <poll.h>
-#include <sys/poll.h>
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
 
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
 #include <functional>
-#include <future>
 #include <iostream>
-#include <iterator>
+#include <limits>
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
 #include <vector>
 
+#include "include/net/poller.h"
 #include "include/net/socket.h"
 
 namespace net {
 
+namespace {
+
+// Whether the address is a path of an existing socket file, abstract
+// addresses and files which aren't sockets are left alone.
+bool HasSocketFile(const Address& address) {
+  std::string path = address.GetPath();
+  struct stat file_status;
+  return !path.empty() && path.front() != '@' &&
+         lstat(path.c_str(), &file_status) == 0 &&
+         S_ISSOCK(file_status.st_mode);
+}
+
+void RemoveSocketFile(const Address& address) noexcept {
+  if (HasSocketFile(address)) {
+    unlink(address.GetPath().c_str());
+  }
+}
+
+// Removes the socket file left by a server which didn't stop cleanly, binding
+// would fail otherwise. Only a file nobody listens on is removed, connecting
+// to it must be refused; throws ServerError if it's in use.
+void RemoveStaleSocketFile(const Address& address, SocketType socket_type) {
+  if (!HasSocketFile(address)) {
+    return;
+  }
+
+  int probe = socket(AF_UNIX, socket_type | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (probe < 0) {
+    throw ServerError("can't probe socket file");
+  }
+  int status_code =
+      connect(probe, address.GetSockAddr(), address.GetSockAddrLength());
+  // a full backlog of a live server fails with EAGAIN
+  bool is_refused = status_code < 0 && errno == ECONNREFUSED;
+  close(probe);
+
+  if (!is_refused) {
+    throw ServerError("address in use");
+  }
+  unlink(address.GetPath().c_str());
+}
+
+}  // namespace
+
 ServerError::ServerError(const std::string& message)
     : std::runtime_error(message) {}
 
 Server::Server(AddressFamilyType listener_address_family,
                SocketType listener_socket_type, ProtocolType listener_protocol)
-    : listener_(std::nullopt, listener_address_family, listener_socket_type,
-                listener_protocol),
-      connections_(),
-      is_serving_(false) {
-  listener_.MakeUnblocking();
+    : Server(ServerOptions(), listener_address_family, listener_socket_type,
+             listener_protocol) {}
+
+Server::Server(const ServerOptions& options,
+               AddressFamilyType listener_address_family,
+               SocketType listener_socket_type, ProtocolType listener_protocol)
+    : options_(options),
+      listener_address_family_(listener_address_family),
+      listener_socket_type_(listener_socket_type),
+      listener_protocol_(listener_protocol),
+      is_serving_(false),
+      response_processor_(nullptr),
+      stop_file_descriptor_(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)),
+      is_stop_requested_(false),
+      next_log_time_(0),
+      stats_mutex_(),
+      stats_(),
+      reactors_(),
+      workers_(),
+      topics_mutex_(),
+      topics_() {
+  if (stop_file_descriptor_ < 0) {
+    throw ServerError("can't create stop descriptor");
+  }
 }
 
+Server::~Server() { close(stop_file_descriptor_); }
+
+Server::Connection::Connection(Socket&& connection_socket, Reactor& owner,
+                               ConnectionId connection_id)
+    : Socket(std::move(connection_socket)),
+      reactor(owner),
+      id(connection_id),
+      mutex(),
+      requests(),
+      request_chunks(),
+      is_scheduled(false),
+      processing(),
+      processing_chunks(),
+      scheduled_self(),
+      outbound(),
+      is_write_requested(false),
+      is_overflown(false),
+      is_closed(false),
+      topics(),
+      serviced_round(0),
+      is_framing_detected(false),
+      receive_stage(ReceiveStage::kIdle),
+      idle_timer(TimerWheel::kInvalidId),
+      read_timer(TimerWheel::kInvalidId),
+      write_timer(TimerWheel::kInvalidId) {}
+
+Server::Reactor::Reactor(size_t reactor_index,
+                         std::vector<Socket>&& reactor_listeners,
+                         std::unique_ptr<Poller> reactor_poller)
+    : index(reactor_index),
+      next_sequence(1),
+      listeners(std::move(reactor_listeners)),
+      poller(std::move(reactor_poller)),
+      counters(),
+      buffers(),
+      mutex(),
+      connections(),
+      connection_ids(),
+      connections_by_id(),
+      backlog(),
+      timers(),
+      expired_timers(),
+      write_requests_mutex(),
+      write_requests() {}
+
 void Server::Serve(const Address& address,
                    const ResponseProcessor& response_processor,
                    int timeout_msec) {
-  if (is_serving_) {
+  Serve(std::vector<Address>{address}, response_processor, timeout_msec);
+}
+
+void Server::Serve(const std::vector<Address>& addresses,
+                   const ResponseProcessor& response_processor,
+                   int timeout_msec) {
+  if (addresses.empty()) {
+    throw ServerError("no addresses to serve on");
+  }
+  if (is_serving_.exchange(true)) {
     throw ServerError("this server is already serving");
   }
 
-  listener_.Bind(address);
-  listener_.Listen(5);
+  size_t reactors_count = options_.reactors_count;
+  if (reactors_count == 0) {
+    reactors_count = std::max(1u, std::thread::hardware_concurrency());
+  }
 
-  is_serving_ = true;
+  // files which another server listens on are never removed
+  std::vector<Address> bound_paths;
+  auto remove_socket_files = [&bound_paths] {
+    for (const auto& address : bound_paths) {
+      RemoveSocketFile(address);
+    }
+  };
 
-  while (true) {
-    std::cerr << "Active connections: " << connections_.size() << std::endl;
+  try {
+    for (size_t i = 0; i < reactors_count; ++i) {
+      std::vector<Socket> listeners;
+      listeners.reserve(addresses.size());
+      for (size_t j = 0; j < addresses.size(); ++j) {
+        if (i == 0 || addresses[j].GetAddressFamily() != AF_UNIX) {
+          // kernel balances incoming connections between the listeners
+          listeners.push_back(MakeListener(addresses[j], reactors_count > 1));
+          if (addresses[j].GetAddressFamily() == AF_UNIX) {
+            bound_paths.push_back(addresses[j]);
+          }
+          continue;
+        }
 
-    // forming file descriptors for polling
-    std::vector<struct pollfd> descriptors;
-    descriptors.reserve(connections_.size() + 1);
+        // a path is bound once, every event loop polls a duplicate of it and
+        // the ones which lose the race for a connection find nothing to accept
+        const Socket& shared = reactors_.front()->listeners[j];
+        listeners.emplace_back(dup(shared.GetFileDescriptor()), AF_UNIX,
+                               shared.GetSocketType(), 0, true);
+      }
 
-    struct pollfd poll_file_descriptor {};
-    poll_file_descriptor.fd = listener_.GetFileDescriptor();
-    poll_file_descriptor.events = POLLIN;
-    descriptors.push_back(poll_file_descriptor);
+      auto poller = Poller::Create(options_.poller_type);
+      poller->Add(stop_file_descriptor_);
+      for (const auto& listener : listeners) {
+        if (poller->IsDoingIo()) {
+          poller->AddListener(listener.GetFileDescriptor());
+        } else {
+          poller->Add(listener.GetFileDescriptor());
+        }
+      }
 
-    for (auto i = connections_.begin(); i != connections_.end(); ++i) {
-      poll_file_descriptor.fd = i->get()->GetFileDescriptor();
-      poll_file_descriptor.events = POLLIN;
-      descriptors.push_back(poll_file_descriptor);
+      auto reactor = std::make_unique<Reactor>(i, std::move(listeners),
+                                               std::move(poller));
+      std::lock_guard lock(stats_mutex_);
+      reactors_.push_back(std::move(reactor));
+    }
+  } catch (...) {
+    {
+      std::lock_guard lock(stats_mutex_);
+      reactors_.clear();
     }
+    remove_socket_files();
+    ClearStop();
+    throw;
+  }
 
-    int status_code =
-        poll(descriptors.data(), descriptors.size(), timeout_msec);
-    if (status_code < 0) {
-      // error while polling
+  std::mutex error_mutex;
+  std::exception_ptr error;
+  auto run_reactor = [&](Reactor& reactor) {
+    try {
+      RunReactor(reactor, timeout_msec);
+    } catch (...) {
+      {
+        std::lock_guard lock(error_mutex);
+        if (!error) {
+          error = std::current_exception();
+        }
+      }
+      Stop();
+    }
+  };
 
-      connections_.clear();
-      is_serving_ = false;
+  // signals are delivered to the calling thread only
+  sigset_t all_signals;
+  sigset_t previous_signals;
+  sigfillset(&all_signals);
+  pthread_sigmask(SIG_BLOCK, &all_signals, &previous_signals);
 
-      throw ServerError("error while serving");
+  size_t workers_count = options_.workers_count;
+  if (workers_count == 0) {
+    workers_count = std::max(1u, std::thread::hardware_concurrency());
+  }
+  response_processor_ = &response_processor;
+  workers_ = std::make_unique<ThreadPool>(workers_count,
+                                          options_.tasks_queue_capacity);
+
+  std::vector<std::thread> threads;
+  threads.reserve(reactors_.size() - 1);
+  for (auto i = ++reactors_.begin(); i != reactors_.end(); ++i) {
+    threads.emplace_back(run_reactor, std::ref(**i));
+  }
+
+  pthread_sigmask(SIG_SETMASK, &previous_signals, nullptr);
+
+  run_reactor(*reactors_.front());
+
+  Stop();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  // requests already handed to workers are still answered
+  workers_.reset();
+  response_processor_ = nullptr;
+  {
+    // subscribers would outlive their event loops otherwise
+    std::lock_guard lock(topics_mutex_);
+    topics_.clear();
+  }
+  {
+    std::lock_guard lock(stats_mutex_);
+    for (const auto& reactor : reactors_) {
+      AddCounters(reactor->counters, stats_);
     }
-    if (status_code == 0) {
-      // no events - skipping
-      continue;
+    reactors_.clear();
+  }
+  remove_socket_files();
+  ClearStop();
+
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+void Server::Stop() noexcept {
+  is_stop_requested_ = true;
+  is_serving_ = false;
+
+  // never read by the event loops, so it wakes up every one of them
+  uint64_t value = 1;
+  if (write(stop_file_descriptor_, &value, sizeof(value)) < 0) {
+    // the counter is saturated, so the event loops are woken up anyway
+  }
+}
+
+bool Server::IsServing() const noexcept { return is_serving_; }
+
+void Server::ClearStop() noexcept {
+  uint64_t stops;
+  if (read(stop_file_descriptor_, &stops, sizeof(stops)) < 0) {
+    // wasn't stopped
+  }
+  is_stop_requested_ = false;
+  is_serving_ = false;
+}
+
+size_t Server::GetConnectionsCount() const {
+  size_t count = 0;
+  for (const auto& reactor : reactors_) {
+    std::lock_guard lock(reactor->mutex);
+    count += reactor->connections.Size();
+  }
+
+  return count;
+}
+
+void Server::ForEachConnection(const ConnectionVisitor& visitor) const {
+  for (const auto& reactor : reactors_) {
+    std::lock_guard lock(reactor->mutex);
+    for (const auto& connection : reactor->connections) {
+      visitor(connection);
     }
+  }
+}
 
-    std::vector<std::shared_ptr<Socket>> active_connections;
-    active_connections.reserve(connections_.size());
+ServerStats Server::GetStats() const {
+  std::lock_guard lock(stats_mutex_);
+  ServerStats stats = stats_;
+  for (const auto& reactor : reactors_) {
+    AddCounters(reactor->counters, stats);
+  }
 
-    if (descriptors.front().revents & POLLIN) {
-      // new client wants to connect
+  return stats;
+}
+
+Server::ConnectionId Server::GetConnectionId(
+    const std::shared_ptr<Socket>& connection) const {
+  auto server_connection = std::dynamic_pointer_cast<Connection>(connection);
+  if (!server_connection) {
+    throw ServerError("socket isn't a connection of this server");
+  }
 
-      active_connections.emplace_back(
-          std::make_shared<Socket>(listener_.Accept()));
-      active_connections.back()->SetLinger();
-      active_connections.back()->MakeUnblocking();
+  return server_connection->id;
+}
+
+std::shared_ptr<Socket> Server::GetConnection(ConnectionId id) const {
+  if (reactors_.empty()) {
+    return nullptr;
+  }
+
+  const Reactor& reactor = *reactors_[id % reactors_.size()];
+  std::lock_guard lock(reactor.mutex);
+  auto found = reactor.connections_by_id.find(id);
+  if (found == reactor.connections_by_id.end()) {
+    return nullptr;
+  }
+
+  return *reactor.connections.Find(found->second);
+}
+
+Status Server::Send(const std::shared_ptr<Socket>& connection,
+                    Message message, const FrameHeader& header) {
+  auto server_connection = std::dynamic_pointer_cast<Connection>(connection);
+  if (!server_connection) {
+    throw ServerError("socket isn't a connection of this server");
+  }
+
+  auto data = Frame(std::move(message), header);
+  return Enqueue(server_connection, data);
+}
+
+size_t Server::Broadcast(Message message,
+                         const std::shared_ptr<Socket>& except) {
+  auto data = Frame(std::move(message), FrameHeader());
+
+  size_t queued = 0;
+  for (const auto& reactor : reactors_) {
+    std::lock_guard lock(reactor->mutex);
+    for (const auto& connection : reactor->connections) {
+      if (connection != except && Enqueue(connection, data) == Status::kOk) {
+        ++queued;
+      }
     }
+  }
 
-    for (auto i = ++descriptors.begin(); i != descriptors.end(); ++i) {
-      auto connection_iter =
-          connections_.begin() + std::distance(descriptors.begin(), i) - 1;
+  return queued;
+}
 
-      if (i->revents & POLLIN) {
-        auto future =
-            std::async(&Server::ProcessConnection, this, *connection_iter,
-                       std::ref(response_processor));
+Status Server::Subscribe(const std::shared_ptr<Socket>& connection,
+                         const std::string& topic) {
+  auto server_connection = std::dynamic_pointer_cast<Connection>(connection);
+  if (!server_connection) {
+    throw ServerError("socket isn't a connection of this server");
+  }
 
-        try {
-          future.get();
-        } catch (...) {
-          // this connection is closed also!!!!
-          continue;
+  std::lock_guard lock(topics_mutex_);
+  // the event loop marks it closed before dropping its subscriptions, so a
+  // closed connection is never left subscribed
+  if (server_connection->is_closed) {
+    return Status::kClosed;
+  }
+
+  if (topics_[topic].insert(server_connection).second) {
+    server_connection->topics.push_back(topic);
+  }
+  return Status::kOk;
+}
+
+bool Server::Unsubscribe(const std::shared_ptr<Socket>& connection,
+                         const std::string& topic) {
+  auto server_connection = std::dynamic_pointer_cast<Connection>(connection);
+  if (!server_connection) {
+    throw ServerError("socket isn't a connection of this server");
+  }
+
+  std::lock_guard lock(topics_mutex_);
+  auto subscribers = topics_.find(topic);
+  if (subscribers == topics_.end() ||
+      subscribers->second.erase(server_connection) == 0) {
+    return false;
+  }
+  if (subscribers->second.empty()) {
+    topics_.erase(subscribers);
+  }
+
+  auto& topics = server_connection->topics;
+  topics.erase(std::find(topics.begin(), topics.end(), topic));
+  return true;
+}
+
+size_t Server::Publish(const std::string& topic, Message message) {
+  auto data = Frame(std::move(message), FrameHeader());
+
+  size_t queued = 0;
+  std::shared_lock lock(topics_mutex_);
+  auto subscribers = topics_.find(topic);
+  if (subscribers == topics_.end()) {
+    return 0;
+  }
+
+  for (const auto& connection : subscribers->second) {
+    if (Enqueue(connection, data) == Status::kOk) {
+      ++queued;
+    }
+  }
+
+  return queued;
+}
+
+void Server::RunReactor(Reactor& reactor, int timeout_msec) {
+  std::vector<PollEvent> events;
+  std::vector<std::shared_ptr<Connection>> previous_backlog;
+  uint64_t round = 0;
+
+  while (!is_stop_requested_) {
+    if (options_.log_level != LogLevel::kSilent && IsLogDue()) {
+      std::cerr << "Active connections: " << GetConnectionsCount() << std::endl;
+    }
+
+    // backlogged connections have requests in their buffers already, so
+    // they must not wait for new readiness
+    int wait_timeout_msec = reactor.backlog.empty() ? timeout_msec : 0;
+    auto wait_start = std::chrono::steady_clock::now();
+    auto timers_timeout = reactor.timers.GetNextTimeout(wait_start);
+    if (timers_timeout.has_value()) {
+      // rounded up, waking up a bit early would just wait again
+      auto timers_timeout_msec = static_cast<int>(
+          std::chrono::ceil<std::chrono::milliseconds>(timers_timeout.value())
+              .count());
+      if (wait_timeout_msec < 0 || timers_timeout_msec < wait_timeout_msec) {
+        wait_timeout_msec = timers_timeout_msec;
+      }
+    }
+    try {
+      reactor.poller->Wait(events, wait_timeout_msec);
+    } catch (const PollerError&) {
+      // error while polling
+      throw ServerError("error while serving");
+    }
+
+    // wakeups return without events as well, only the elapsed time tells
+    if (events.empty() && wait_timeout_msec > 0 &&
+        std::chrono::steady_clock::now() - wait_start >=
+            std::chrono::milliseconds(wait_timeout_msec)) {
+      reactor.counters.timeouts.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    {
+      std::vector<std::shared_ptr<Connection>> write_requests;
+      {
+        std::lock_guard lock(reactor.write_requests_mutex);
+        write_requests.swap(reactor.write_requests);
+      }
+
+      for (const auto& connection : write_requests) {
+        if (!connection->is_closed) {
+          std::lock_guard lock(connection->mutex);
+          AwaitWritable(reactor, *connection);
+          SetTimer(reactor, *connection, connection->write_timer,
+                   options_.write_stall_timeout_msec);
         }
-      } else if (i->revents & POLLHUP) {
-        // closed connection case
+      }
+    }
+
+    ExpireTimers(reactor);
+
+    ++round;
+    previous_backlog.swap(reactor.backlog);
+
+    auto service = [&](const std::shared_ptr<Connection>& connection,
+                       std::string_view received) {
+      connection->serviced_round = round;
+      try {
+        bool is_backlogged = ReceiveRequests(connection, received);
+        if (is_backlogged) {
+          reactor.backlog.push_back(connection);
+        }
+        if (reactor.poller->IsDoingIo()) {
+          // nothing more is received until the backlog is worked off
+          reactor.poller->SetReceiving(connection->GetFileDescriptor(),
+                                       !is_backlogged);
+        }
+      } catch (...) {
+        // this connection is closed also!!!!
+        RemoveConnection(reactor, connection->GetFileDescriptor());
+      }
+    };
+
+    // only ready descriptors are reported, idle connections cost nothing here
+    for (const auto& event : events) {
+      if (event.file_descriptor == stop_file_descriptor_) {
+        // the loop condition tells
+        continue;
+      }
+
+      auto listener = std::find_if(
+          reactor.listeners.begin(), reactor.listeners.end(),
+          [&event](const Socket& candidate) {
+            return candidate.GetFileDescriptor() == event.file_descriptor;
+          });
+      if (listener != reactor.listeners.end()) {
+        // new client wants to connect
+        if (event.accepted >= 0) {
+          AddConnection(reactor,
+                        Socket(event.accepted, listener->GetAddressFamily(),
+                               listener->GetSocketType(),
+                               listener->GetProtocol(), true));
+        } else {
+          AcceptConnection(reactor, *listener);
+        }
+        continue;
+      }
+
+      auto* found = FindConnection(reactor, event.file_descriptor);
+      if (found == nullptr) {
         continue;
       }
+      // may be removed from the reactor while being serviced
+      auto connection = *found;
+
+      if (event.is_writable) {
+        FlushConnection(reactor, connection, event);
+      }
+
+      if (connection->is_closed) {
+        continue;
+      }
+
+      if (event.is_readable) {
+        service(connection, event.received);
+      } else if (event.is_closed) {
+        // closed connection case
+        RemoveConnection(reactor, event.file_descriptor);
+      }
+    }
+
+    // connections that ran out of budget go after the ready ones
+    for (const auto& connection : previous_backlog) {
+      if (!connection->is_closed && connection->serviced_round != round) {
+        service(connection, {});
+      }
+    }
+    previous_backlog.clear();
+  }
+}
+
+bool Server::ReceiveRequests(const std::shared_ptr<Connection>& connection,
+                             std::string_view received_data) {
+  size_t budget = options_.max_requests_per_wakeup;
+  if (budget == 0) {
+    budget = std::numeric_limits<size_t>::max();
+  }
+
+  // one read may bring several requests, all of them up to the budget are
+  // queued at once since the rest stays in the user space buffer and won't
+  // be polled again
+  size_t max_chunk_size = options_.streaming_threshold;
+  if (max_chunk_size == 0) {
+    max_chunk_size = std::numeric_limits<size_t>::max();
+  }
+
+  Reactor& reactor = connection->reactor;
+  size_t received = 0;
+  auto extract_requests = [&] {
+    if (!connection->is_framing_detected) {
+      if (!DetectFraming(*connection)) {
+        return;
+      }
+      OnFramingDetected(connection);
+    }
+
+    std::lock_guard lock(connection->mutex);
+    while (received != budget) {
+      auto size = connection->GetNextChunkSize(max_chunk_size);
+      if (!size.has_value()) {
+        break;
+      }
+
+      std::string request = reactor.buffers.Acquire(size.value());
+      MessageChunk chunk;
+      connection->ExtractChunk(request, chunk, max_chunk_size);
+      reactor.counters.bytes_in.fetch_add(request.size(),
+                                          std::memory_order_relaxed);
+      connection->requests.push_back(std::move(request));
+      connection->request_chunks.push_back(chunk);
+      ++received;
+    }
+  };
 
-      active_connections.emplace_back(*connection_iter);
+  if (reactor.poller->IsDoingIo()) {
+    // the poller has read the socket already
+    connection->AppendReceived(received_data);
+    extract_requests();
+  } else {
+    // leftovers of the previous read go first
+    extract_requests();
+  }
+  if (received != budget && !reactor.poller->IsDoingIo()) {
+    Status status = connection->ReceiveAvailable();
+    if (status == Status::kClosed) {
+      throw ServerError("connection closed");
     }
 
-    connections_ = std::move(active_connections);
+    extract_requests();
   }
 
-  connections_.clear();
-  is_serving_ = false;
+  UpdateReadTimers(reactor, *connection, received != 0);
+
+  if (received != 0) {
+    reactor.counters.frames_in.fetch_add(received, std::memory_order_relaxed);
+
+    std::unique_lock lock(connection->mutex);
+    if (!connection->is_scheduled) {
+      connection->is_scheduled = true;
+      connection->scheduled_self = connection;
+      lock.unlock();
+
+      workers_->Submit([this, scheduled = connection.get()] {
+        // nothing else touches it until the connection is unscheduled
+        ProcessRequests(std::move(scheduled->scheduled_self));
+      });
+    }
+    // otherwise the worker already owning this connection will pick them up
+  }
+
+  return received == budget;
 }
 
-bool Server::IsServing() const noexcept { return is_serving_; }
+bool Server::DetectFraming(Connection& connection) {
+  // framing is read by senders with the connection locked
+  std::unique_lock lock(connection.mutex);
+  auto framing = connection.DetectFraming();
+  if (!framing.has_value()) {
+    return false;
+  }
+
+  connection.is_framing_detected = true;
+  if (framing.value() == Framing::kText) {
+    return true;
+  }
+
+  // text frames queued before go first, the peer drops them
+  size_t pending = connection.outbound.Size();
+  connection.outbound.Push(std::make_shared<const std::string>(
+      Socket::MakeHandshake(connection.GetProtocolVersion())));
+  if (pending != 0) {
+    // the event loop is already waiting for the socket to become writable
+    return true;
+  }
+
+  Status status = connection.outbound.Flush(connection);
+  if (status == Status::kClosed) {
+    throw ServerError("connection closed");
+  }
+
+  if (status == Status::kTimeout && !connection.is_write_requested) {
+    connection.is_write_requested = true;
+    AwaitWritable(connection.reactor, connection);
+    SetTimer(connection.reactor, connection, connection.write_timer,
+             options_.write_stall_timeout_msec);
+  }
+
+  return true;
+}
+
+void Server::ProcessRequests(const std::shared_ptr<Connection>& connection) {
+  auto& batch = connection->processing;
+  auto& chunks = connection->processing_chunks;
+  while (true) {
+    {
+      std::lock_guard lock(connection->mutex);
+      if (connection->requests.empty()) {
+        connection->is_scheduled = false;
+        return;
+      }
 
-void Server::ProcessConnection(std::shared_ptr<Socket> connection,
-                               const ResponseProcessor& response_processor) {
-  auto response = connection->Receive();
-  if (response.status != Status::kOk) {
+      // everything received so far, all vectors keep their capacity
+      batch.swap(connection->requests);
+      chunks.swap(connection->request_chunks);
+    }
+
+    for (size_t i = 0; i < batch.size(); ++i) {
+      try {
+        if (chunks[i].offset == 0 &&
+            chunks[i].message_size == batch[i].size()) {
+          ProcessRequest(connection, batch[i], chunks[i].header,
+                         *response_processor_);
+        } else {
+          ProcessRequestChunk(connection, batch[i], chunks[i]);
+        }
+      } catch (...) {
+        // the owning event loop removes the connection once it sees it closed
+        connection->Shutdown();
+      }
+    }
+    connection->reactor.buffers.Release(batch);
+    chunks.clear();
+  }
+}
+
+Server::FramedMessage Server::Frame(Message message,
+                                    const FrameHeader& header) {
+  // parts are shared, not copied
+  return FramedMessage{header, message.Size(), message.TakeParts(), nullptr,
+                       nullptr};
+}
+
+Status Server::Enqueue(const std::shared_ptr<Connection>& connection,
+                       FramedMessage& message) {
+  std::unique_lock lock(connection->mutex);
+  if (connection->is_closed) {
+    return Status::kClosed;
+  }
+
+  Framing framing = connection->GetFraming();
+  auto& header = framing == Framing::kBinary ? message.binary_header
+                                             : message.text_header;
+  if (!header) {
+    header = std::make_shared<const std::string>(
+        Socket::MakeHeader(message.size, framing, message.header));
+  }
+  size_t message_size = header->size() + message.size;
+
+  size_t pending = connection->outbound.Size();
+  if (connection->is_overflown && pending <= options_.outbound_low_watermark) {
+    connection->is_overflown = false;
+  }
+
+  if (connection->is_overflown ||
+      (pending != 0 &&
+       pending + message_size > options_.outbound_high_watermark)) {
+    // peer doesn't keep up with its messages
+    if (options_.overflow_policy == OverflowPolicy::kDisconnect) {
+      lock.unlock();
+      connection->Shutdown();
+      return Status::kClosed;
+    }
+
+    connection->is_overflown = true;
+    connection->reactor.counters.drops.fetch_add(1, std::memory_order_relaxed);
+    return Status::kDropped;
+  }
+
+  connection->outbound.Push(header);
+  for (const auto& chunk : message.parts) {
+    connection->outbound.Push(chunk);
+  }
+  connection->reactor.counters.frames_out.fetch_add(
+      1, std::memory_order_relaxed);
+  connection->reactor.counters.bytes_out.fetch_add(message.size,
+                                                    std::memory_order_relaxed);
+  if (pending != 0) {
+    // the event loop is already waiting for the socket to become writable
+    return Status::kOk;
+  }
+
+  // most of the time the socket takes everything at once, so the event loop
+  // isn't involved at all
+  Status status = connection->outbound.Flush(*connection);
+  if (status == Status::kClosed) {
+    lock.unlock();
+    connection->Shutdown();
+    return Status::kClosed;
+  }
+
+  if (status == Status::kTimeout && !connection->is_write_requested) {
+    connection->is_write_requested = true;
+    lock.unlock();
+
+    Reactor& reactor = connection->reactor;
+    {
+      std::lock_guard reactor_lock(reactor.write_requests_mutex);
+      reactor.write_requests.push_back(connection);
+    }
+    reactor.poller->Wakeup();
+  }
+
+  return Status::kOk;
+}
+
+void Server::AwaitWritable(Reactor& reactor, Connection& connection) {
+  FileDescriptorType file_descriptor = connection.GetFileDescriptor();
+  if (!reactor.poller->IsDoingIo()) {
+    reactor.poller->SetWritable(file_descriptor, true);
     return;
   }
 
-  std::string processed = response_processor(connection, response.data);
-  if (!processed.empty()) {
-    connection->Send(processed);
+  // the chunks stay queued until the send completes, so workers don't write
+  // to the socket meanwhile
+  struct iovec buffers[OutboundQueue::kMaxBuffersPerWrite];
+  std::vector<std::shared_ptr<const std::string>> owners;
+  size_t count = connection.outbound.Gather(buffers, owners);
+  reactor.poller->Send(file_descriptor, buffers, count, std::move(owners));
+}
+
+void Server::FlushConnection(Reactor& reactor,
+                             const std::shared_ptr<Connection>& connection,
+                             const PollEvent& event) {
+  std::unique_lock lock(connection->mutex);
+
+  size_t pending = connection->outbound.Size();
+  Status status;
+  if (reactor.poller->IsDoingIo()) {
+    connection->outbound.Consume(event.sent);
+    if (event.is_closed) {
+      status = Status::kClosed;
+    } else if (connection->outbound.Size() != 0) {
+      status = Status::kTimeout;
+      AwaitWritable(reactor, *connection);
+    } else {
+      status = Status::kOk;
+    }
+  } else {
+    try {
+      status = connection->outbound.Flush(*connection);
+    } catch (const SocketError&) {
+      status = Status::kClosed;
+    }
   }
+
+  if (status == Status::kClosed) {
+    lock.unlock();
+    RemoveConnection(reactor, connection->GetFileDescriptor());
+    return;
+  }
+
+  if (status == Status::kOk) {
+    connection->is_write_requested = false;
+    if (!reactor.poller->IsDoingIo()) {
+      reactor.poller->SetWritable(connection->GetFileDescriptor(), false);
+    }
+    reactor.timers.Cancel(connection->write_timer);
+    connection->write_timer = TimerWheel::kInvalidId;
+  } else if (connection->outbound.Size() < pending) {
+    // the peer is slow but still reading
+    SetTimer(reactor, *connection, connection->write_timer,
+             options_.write_stall_timeout_msec);
+  }
+}
+
+void Server::SetTimer(Reactor& reactor, const Connection& connection,
+                      TimerWheel::Id& timer, int timeout_msec) {
+  reactor.timers.Cancel(timer);
+  timer = TimerWheel::kInvalidId;
+  if (timeout_msec <= 0) {
+    return;
+  }
+
+  // expired timers find their connections by id, a removed connection
+  // leaves a stale id which is found no more
+  auto id = reactor.connection_ids[connection.GetFileDescriptor()];
+  timer = reactor.timers.Schedule(std::chrono::steady_clock::now() +
+                                      std::chrono::milliseconds(timeout_msec),
+                                  id);
+}
+
+void Server::UpdateReadTimers(Reactor& reactor, Connection& connection,
+                              bool has_received) {
+  if (has_received) {
+    SetTimer(reactor, connection, connection.idle_timer,
+             options_.idle_timeout_msec);
+  }
+
+  // a partial handshake is as good as a partial header
+  auto stage = connection.is_framing_detected ? connection.GetReceiveStage()
+                                              : Socket::ReceiveStage::kHeader;
+  // deadlines run from the start of a stage, not from the last bytes
+  if (stage == connection.receive_stage && !has_received) {
+    return;
+  }
+
+  connection.receive_stage = stage;
+  switch (stage) {
+    case Socket::ReceiveStage::kIdle:
+      SetTimer(reactor, connection, connection.read_timer, 0);
+      break;
+    case Socket::ReceiveStage::kHeader:
+      SetTimer(reactor, connection, connection.read_timer,
+               options_.header_timeout_msec);
+      break;
+    case Socket::ReceiveStage::kBody:
+      SetTimer(reactor, connection, connection.read_timer,
+               options_.body_timeout_msec);
+      break;
+  }
+}
+
+void Server::ExpireTimers(Reactor& reactor) {
+  auto& expired = reactor.expired_timers;
+  reactor.timers.Advance(std::chrono::steady_clock::now(), expired);
+
+  for (auto id : expired) {
+    auto* found = reactor.connections.Find(id);
+    if (found == nullptr) {
+      // another timer of the same connection has closed it already
+      continue;
+    }
+
+    FileDescriptorType file_descriptor = (*found)->GetFileDescriptor();
+    reactor.counters.evictions.fetch_add(1, std::memory_order_relaxed);
+    if (options_.log_level == LogLevel::kDebug) {
+      std::cerr << "Evicted connection " << file_descriptor << std::endl;
+    }
+    RemoveConnection(reactor, file_descriptor);
+  }
+  expired.clear();
+}
+
+std::shared_ptr<Server::Connection>* Server::FindConnection(
+    Reactor& reactor, FileDescriptorType file_descriptor) noexcept {
+  if (file_descriptor < 0 ||
+      static_cast<size_t>(file_descriptor) >= reactor.connection_ids.size()) {
+    return nullptr;
+  }
+
+  return reactor.connections.Find(reactor.connection_ids[file_descriptor]);
+}
+
+Socket Server::MakeListener(const Address& address,
+                            bool is_port_shared) const {
+  bool is_unix = address.GetAddressFamily() == AF_UNIX;
+  Socket listener(std::nullopt, is_unix ? AF_UNIX : listener_address_family_,
+                  listener_socket_type_, is_unix ? 0 : listener_protocol_);
+  listener.MakeUnblocking();
+  if (is_unix) {
+    RemoveStaleSocketFile(address, listener_socket_type_);
+  } else if (is_port_shared) {
+    listener.SetReusablePort();
+  }
+  listener.Bind(address);
+  listener.Listen(5);
+
+  return listener;
+}
+
+void Server::AcceptConnection(Reactor& reactor, Socket& listener) {
+  auto accepted = listener.AcceptAvailable();
+  if (accepted.has_value()) {
+    AddConnection(reactor, std::move(accepted.value()));
+  }
+}
+
+void Server::AddConnection(Reactor& reactor, Socket&& accepted) {
+  ConnectionId id =
+      reactor.next_sequence++ * reactors_.size() + reactor.index;
+  auto connection =
+      std::make_shared<Connection>(std::move(accepted), reactor, id);
+  connection->SetLinger();
+  connection->MakeUnblocking();
+  connection->SetMaxMessageSize(options_.max_message_size);
+  connection->SetMaxStreamedMessageSize(options_.max_streamed_message_size);
+  if (connection->GetAddressFamily() == AF_INET &&
+      connection->GetSocketType() == SOCK_STREAM) {
+    connection->SetNoDelay();
+  }
+
+  FileDescriptorType file_descriptor = connection->GetFileDescriptor();
+  if (reactor.poller->IsDoingIo()) {
+    reactor.poller->AddConnection(file_descriptor);
+  } else {
+    reactor.poller->Add(file_descriptor);
+  }
+
+  reactor.counters.accepts.fetch_add(1, std::memory_order_relaxed);
+  if (options_.log_level == LogLevel::kDebug) {
+    std::cerr << "Accepted connection " << file_descriptor << std::endl;
+  }
+
+  std::lock_guard lock(reactor.mutex);
+  if (static_cast<size_t>(file_descriptor) >= reactor.connection_ids.size()) {
+    reactor.connection_ids.resize(file_descriptor + 1,
+                                  ConnectionTable::kInvalidId);
+  }
+  auto table_id = reactor.connections.Insert(connection);
+  reactor.connection_ids[file_descriptor] = table_id;
+  reactor.connections_by_id.emplace(id, table_id);
+  SetTimer(reactor, *connection, connection->idle_timer,
+           options_.idle_timeout_msec);
+}
+
+void Server::RemoveConnection(Reactor& reactor,
+                              FileDescriptorType file_descriptor) {
+  auto* found = FindConnection(reactor, file_descriptor);
+  if (found == nullptr) {
+    return;
+  }
+
+  reactor.poller->Remove(file_descriptor);
+  (*found)->is_closed = true;
+  for (auto timer : {(*found)->idle_timer, (*found)->read_timer,
+                     (*found)->write_timer}) {
+    reactor.timers.Cancel(timer);
+  }
+
+  reactor.counters.closes.fetch_add(1, std::memory_order_relaxed);
+  if (options_.log_level == LogLevel::kDebug) {
+    std::cerr << "Closed connection " << file_descriptor << std::endl;
+  }
+  try {
+    // close must not block the event loop on a peer which doesn't read
+    (*found)->SetLinger(0);
+  } catch (const SocketError&) {
+    // ignore
+  }
+
+  UnsubscribeAll(*found);
+
+  // the socket is closed after the lock is released
+  std::shared_ptr<Connection> removed;
+  {
+    std::lock_guard lock(reactor.mutex);
+
+    auto& id = reactor.connection_ids[file_descriptor];
+    removed = reactor.connections.Erase(id);
+    id = ConnectionTable::kInvalidId;
+    reactor.connections_by_id.erase(removed->id);
+  }
+
+  OnConnectionClosed(removed->id);
+}
+
+void Server::UnsubscribeAll(const std::shared_ptr<Connection>& connection) {
+  std::lock_guard lock(topics_mutex_);
+  // only the topics of the connection are visited, not every topic
+  for (const auto& topic : connection->topics) {
+    auto subscribers = topics_.find(topic);
+    subscribers->second.erase(connection);
+    if (subscribers->second.empty()) {
+      topics_.erase(subscribers);
+    }
+  }
+  connection->topics.clear();
+}
+
+void Server::AddCounters(const Counters& counters, ServerStats& stats) {
+  stats.accepts += counters.accepts.load(std::memory_order_relaxed);
+  stats.closes += counters.closes.load(std::memory_order_relaxed);
+  stats.frames_in += counters.frames_in.load(std::memory_order_relaxed);
+  stats.bytes_in += counters.bytes_in.load(std::memory_order_relaxed);
+  stats.frames_out += counters.frames_out.load(std::memory_order_relaxed);
+  stats.bytes_out += counters.bytes_out.load(std::memory_order_relaxed);
+  stats.timeouts += counters.timeouts.load(std::memory_order_relaxed);
+  stats.evictions += counters.evictions.load(std::memory_order_relaxed);
+  stats.drops += counters.drops.load(std::memory_order_relaxed);
 }
 
+bool Server::IsLogDue() noexcept {
+  int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch())
+                    .count();
+  int64_t next = next_log_time_.load(std::memory_order_relaxed);
+  if (now < next) {
+    return false;
+  }
+
+  // only the event loop which moves the time forward logs
+  int64_t interval =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::milliseconds(options_.log_interval_msec))
+          .count();
+  return next_log_time_.compare_exchange_strong(next, now + interval,
+                                                std::memory_order_relaxed);
+}
+
+void Server::ProcessRequest(std::shared_ptr<Socket> connection,
+                            const std::string& request,
+                            const FrameHeader& header,
+                            const ResponseProcessor& response_processor) {
+  Message processed = response_processor(connection, request);
+  if (!processed.Empty()) {
+    // the response carries the ids of its request, so a pipelining client
+    // may match them
+    Send(connection, std::move(processed),
+         FrameHeader{header.request_id, header.command_id, 0});
+  }
+}
+
+void Server::ProcessRequestChunk(std::shared_ptr<Socket>, const std::string&,
+                                 const MessageChunk&) {
+  throw ServerError("streamed requests aren't supported");
+}
+
+void Server::OnFramingDetected(std::shared_ptr<Socket>) {}
+
+void Server::OnConnectionClosed(ConnectionId) {}
+
 }  // namespace net
@@ -1,21 +1,73 @@
 #include "include/net/socket.h"
 
 #include <asm-generic/socket.h>
+#include <errno.h>
 #include <fcntl.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <limits.h>
 #include <strings.h>
 #include <sys/poll.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
 #include <cstring>
+#include <iterator>
+#include <limits>
+#include <mutex>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
 
 #include "include/net/address.h"
+#include "include/net/frame.h"
+#include "include/net/receive_buffer.h"
 
 namespace net {
 
+namespace {
+
+constexpr char kHandshakeMagic[] = {'\0', 'F', 'R', 'M'};
+
+void StoreLittleEndian(char* data, uint64_t value, size_t size) noexcept {
+  for (size_t i = 0; i < size; ++i) {
+    data[i] = static_cast<char>(value >> (8 * i));
+  }
+}
+
+uint64_t LoadLittleEndian(const char* data, size_t size) noexcept {
+  uint64_t value = 0;
+  for (size_t i = 0; i < size; ++i) {
+    value |= uint64_t(static_cast<unsigned char>(data[i])) << (8 * i);
+  }
+  return value;
+}
+
+// Returns the version of a complete handshake at the start of the data.
+uint16_t ParseHandshake(std::string_view data) {
+  if (data.compare(0, sizeof(kHandshakeMagic), kHandshakeMagic,
+                   sizeof(kHandshakeMagic)) != 0) {
+    throw SocketError("invalid handshake");
+  }
+
+  auto version = static_cast<uint16_t>(
+      LoadLittleEndian(data.data() + sizeof(kHandshakeMagic), 2));
+  if (version == 0) {
+    throw SocketError("invalid handshake");
+  }
+  return version;
+}
+
+}  // namespace
+
 SocketError::SocketError(const std::string& message)
     : std::logic_error(message) {}
 
@@ -26,7 +78,14 @@ Socket::Socket(std::optional<FileDescriptorType> file_descriptor,
       socket_type_(socket_type),
       protocol_(protocol),
       file_descriptor_(),
-      is_unblocking_(is_unblocking) {
+      is_unblocking_(is_unblocking),
+      framing_(Framing::kText),
+      protocol_version_(0),
+      max_message_size_(kDefaultMaxMessageSize),
+      max_streamed_message_size_(kDefaultMaxStreamedMessageSize),
+      stream_(),
+      receive_buffer_(),
+      send_mutex_() {
   if (!file_descriptor.has_value()) {
     file_descriptor_ = socket(address_family, socket_type, 0);
   } else {
@@ -55,7 +114,14 @@ Socket::Socket(Socket&& other) noexcept
       socket_type_(other.socket_type_),
       protocol_(other.protocol_),
       file_descriptor_(other.file_descriptor_),
-      is_unblocking_(other.is_unblocking_) {
+      is_unblocking_(other.is_unblocking_),
+      framing_(other.framing_),
+      protocol_version_(other.protocol_version_),
+      max_message_size_(other.max_message_size_),
+      max_streamed_message_size_(other.max_streamed_message_size_),
+      stream_(other.stream_),
+      receive_buffer_(std::move(other.receive_buffer_)),
+      send_mutex_() {
   other.file_descriptor_ = -1;
 }
 
@@ -106,23 +172,35 @@ void Socket::SetReusable() {
   }
 }
 
-void Socket::Bind(const Address& address) {
-  struct sockaddr_in address_info = address.GetAddressInfo();
+void Socket::SetReusablePort() {
+  int enable = 1;
+  int status = setsockopt(GetFileDescriptor(), SOL_SOCKET, SO_REUSEPORT,
+                          &enable, sizeof(enable));
+  if (status < 0) {
+    throw SocketError("can't set reusable port option");
+  }
+}
+
+void Socket::SetNoDelay() {
+  int enable = 1;
+  int status = setsockopt(GetFileDescriptor(), IPPROTO_TCP, TCP_NODELAY,
+                          &enable, sizeof(enable));
+  if (status < 0) {
+    throw SocketError("can't set no delay option");
+  }
+}
 
-  int status_code = bind(GetFileDescriptor(),
-                         reinterpret_cast<struct sockaddr*>(&address_info),
-                         sizeof(address_info));
+void Socket::Bind(const Address& address) {
+  int status_code = bind(GetFileDescriptor(), address.GetSockAddr(),
+                         address.GetSockAddrLength());
   if (status_code < 0) {
     throw SocketError("can't bind socket to the address");
   }
 }
 
 void Socket::Connect(const Address& address) {
-  struct sockaddr_in address_info = address.GetAddressInfo();
-
-  int status_code = connect(GetFileDescriptor(),
-                            reinterpret_cast<struct sockaddr*>(&address_info),
-                            sizeof(address_info));
+  int status_code = connect(GetFileDescriptor(), address.GetSockAddr(),
+                            address.GetSockAddrLength());
   if (status_code < 0) {
     throw SocketError("can't connect socket to the address");
   }
@@ -136,7 +214,7 @@ void Socket::Listen(int queue_size) {
 }
 
 Socket Socket::Accept() {
-  struct sockaddr_in new_address_info;
+  struct sockaddr_storage new_address_info;
   socklen_t new_address_info_length = sizeof(new_address_info);
 
   int new_file_descriptor =
@@ -151,87 +229,437 @@ Socket Socket::Accept() {
                 GetProtocol(), false);
 }
 
-Response<std::string> Socket::Receive(int timeout_msec) {
-  auto response = ReadMessageLengthHeader(timeout_msec);
-  if (response.status != Status::kOk) {
-    return Response<std::string>{"", response.status};
+std::optional<Socket> Socket::AcceptAvailable() {
+  int new_file_descriptor =
+      accept4(GetFileDescriptor(), nullptr, nullptr, SOCK_NONBLOCK);
+  if (new_file_descriptor < 0) {
+    // the pending connection may have been reset or taken by another thread
+    if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR ||
+        errno == ECONNABORTED) {
+      return std::nullopt;
+    }
+    throw SocketError("can't accept on this socket");
   }
 
-  size_t message_length = response.data;
-  std::string result(message_length, '\0');
-  size_t readed_bytes = 0;
+  return Socket(new_file_descriptor, GetAddressFamily(), GetSocketType(),
+                GetProtocol(), true);
+}
 
-  struct pollfd fds[1];
-  fds[0].fd = GetFileDescriptor();
-  fds[0].events = POLLIN;
+std::pair<Socket, Socket> Socket::MakePair(SocketType socket_type) {
+  int file_descriptors[2];
+  int status_code = socketpair(AF_UNIX, socket_type, 0, file_descriptors);
+  if (status_code < 0) {
+    throw SocketError("can't create socket pair");
+  }
+
+  return {Socket(file_descriptors[0], AF_UNIX, socket_type),
+          Socket(file_descriptors[1], AF_UNIX, socket_type)};
+}
+
+void Socket::SetMaxMessageSize(size_t max_message_size) noexcept {
+  max_message_size_ = max_message_size;
+}
+
+size_t Socket::GetMaxMessageSize() const noexcept { return max_message_size_; }
+
+void Socket::SetMaxStreamedMessageSize(
+    size_t max_streamed_message_size) noexcept {
+  max_streamed_message_size_ = max_streamed_message_size;
+}
+
+size_t Socket::GetMaxStreamedMessageSize() const noexcept {
+  return max_streamed_message_size_;
+}
 
-  while (readed_bytes != message_length) {
-    int status = poll(fds, 1, timeout_msec);
-    if (status < 0) {
-      throw SocketError("error while polling");
+Framing Socket::GetFraming() const noexcept { return framing_; }
+
+uint16_t Socket::GetProtocolVersion() const noexcept {
+  return protocol_version_;
+}
+
+Status Socket::NegotiateFraming(int timeout_msec) {
+  Deadline deadline = MakeDeadline(timeout_msec);
+  {
+    std::lock_guard lock(send_mutex_);
+    std::string handshake = MakeHandshake(kProtocolVersion);
+    std::vector<struct iovec> buffers = {{handshake.data(), handshake.size()}};
+    Status status = SendBuffers(buffers, deadline);
+    if (status != Status::kOk) {
+      return status;
     }
-    if (status == 0) {
-      return Response<std::string>{"", Status::kTimeout};
+  }
+
+  std::string dropped;
+  while (true) {
+    std::string_view data = receive_buffer_.Data();
+    if (!data.empty() && data.front() != kHandshakeMagic[0]) {
+      // text frame queued before the peer has seen the handshake
+      if (ExtractMessage(dropped)) {
+        continue;
+      }
+    } else if (data.size() >= kHandshakeSize) {
+      uint16_t version = ParseHandshake(data);
+      if (version > kProtocolVersion) {
+        throw SocketError("invalid handshake");
+      }
+
+      receive_buffer_.Consume(kHandshakeSize);
+      framing_ = Framing::kBinary;
+      protocol_version_ = version;
+      return Status::kOk;
     }
 
-    if ((fds[0].revents & POLLHUP) || fds[0].revents & POLLERR) {
-      return Response<std::string>{"", Status::kClosed};
+    Status status = ReceiveAvailable();
+    if (status == Status::kTimeout) {
+      status = Wait(POLLIN, deadline);
     }
+    if (status != Status::kOk) {
+      return status;
+    }
+  }
+}
 
-    if (fds[0].revents & POLLIN) {
-      int n = recv(GetFileDescriptor(), result.data() + readed_bytes,
-                   result.size() - readed_bytes, 0);
-      if (n <= 0) {
-        throw SocketError("error while reading from socket");
-      }
+std::optional<Framing> Socket::DetectFraming() {
+  std::string_view data = receive_buffer_.Data();
+  if (data.empty()) {
+    return std::nullopt;
+  }
 
-      readed_bytes += n;
+  if (data.front() == kHandshakeMagic[0]) {
+    if (data.size() < kHandshakeSize) {
+      return std::nullopt;
     }
 
-    fds[0].revents = 0;
+    uint16_t version = ParseHandshake(data);
+    receive_buffer_.Consume(kHandshakeSize);
+    framing_ = Framing::kBinary;
+    protocol_version_ = std::min(version, kProtocolVersion);
   }
 
-  return Response<std::string>{result, Status::kOk};
+  return framing_;
 }
 
-Status Socket::Send(const std::string& message, int timeout_msec) {
-  std::string message_length_header = std::to_string(message.size()) + ";";
-  std::string message_with_header = message_length_header + message;
+std::string Socket::MakeHandshake(uint16_t version) {
+  std::string handshake(kHandshakeSize, '\0');
+  std::copy(std::begin(kHandshakeMagic), std::end(kHandshakeMagic),
+            handshake.begin());
+  StoreLittleEndian(handshake.data() + sizeof(kHandshakeMagic), version, 2);
+  return handshake;
+}
 
-  struct pollfd fds[1];
-  fds[0].fd = GetFileDescriptor();
-  fds[0].events = POLLOUT;
+void Socket::Shutdown() noexcept { shutdown(GetFileDescriptor(), SHUT_RDWR); }
 
-  size_t total_sended = 0;
-  while (total_sended != message_with_header.size()) {
-    int status = poll(fds, 1, timeout_msec);
-    if (status < 0) {
-      throw SocketError("error while polling");
+Response<std::string> Socket::Receive(int timeout_msec) {
+  std::string message;
+  Status status = Receive(message, timeout_msec);
+  return Response<std::string>{std::move(message), status};
+}
+
+Status Socket::Receive(std::string& message, int timeout_msec) {
+  FrameHeader header;
+  return Receive(message, header, timeout_msec);
+}
+
+Status Socket::Receive(std::string& message, FrameHeader& header,
+                       int timeout_msec) {
+  Deadline deadline = MakeDeadline(timeout_msec);
+  while (true) {
+    if (ExtractMessage(message, header)) {
+      return Status::kOk;
     }
-    if (status == 0) {
-      return Status::kTimeout;
+
+    Status status = ReceiveAvailable();
+    if (status == Status::kTimeout) {
+      // nothing to read yet - waiting for it
+      status = Wait(POLLIN, deadline);
+    }
+    if (status != Status::kOk) {
+      message.clear();
+      return status;
     }
+  }
+}
+
+Status Socket::ReceiveAvailable() {
+  char* data = receive_buffer_.PrepareWrite(kMinReceiveSize);
 
-    if ((fds[0].revents & POLLHUP) || (fds[0].revents & POLLERR)) {
+  ssize_t n = recv(GetFileDescriptor(), data, receive_buffer_.WritableSize(),
+                   MSG_DONTWAIT);
+  if (n < 0) {
+    if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+      return Status::kTimeout;
+    }
+    if (errno == ECONNRESET) {
       return Status::kClosed;
     }
+    throw SocketError("error while reading from socket");
+  }
+  if (n == 0) {
+    return Status::kClosed;
+  }
+
+  receive_buffer_.Commit(n);
+  return Status::kOk;
+}
+
+void Socket::AppendReceived(std::string_view data) {
+  char* buffer = receive_buffer_.PrepareWrite(data.size());
+  std::memcpy(buffer, data.data(), data.size());
+  receive_buffer_.Commit(data.size());
+}
+
+std::optional<std::string> Socket::ExtractMessage() {
+  std::string message;
+  if (!ExtractMessage(message)) {
+    return std::nullopt;
+  }
+
+  return message;
+}
+
+bool Socket::ExtractMessage(std::string& message) {
+  FrameHeader header;
+  return ExtractMessage(message, header);
+}
+
+bool Socket::ExtractMessage(std::string& message, FrameHeader& header) {
+  MessageChunk info;
+  if (!ExtractChunk(message, info, std::numeric_limits<size_t>::max())) {
+    return false;
+  }
+
+  header = info.header;
+  return true;
+}
+
+std::optional<size_t> Socket::GetNextMessageSize() {
+  return GetNextChunkSize(std::numeric_limits<size_t>::max());
+}
+
+bool Socket::ExtractChunk(std::string& chunk, MessageChunk& info,
+                          size_t max_chunk_size) {
+  size_t length;
+  auto found = FindChunk(max_chunk_size, length, info);
+  if (!found.has_value()) {
+    return false;
+  }
+
+  // assign keeps the capacity of the buffer, unlike constructing a new one
+  chunk.assign(found->data(), found->size());
+  receive_buffer_.Consume(length);
+
+  if (stream_.has_value()) {
+    stream_->offset += chunk.size();
+    if (stream_->offset == stream_->message_size) {
+      stream_.reset();
+    }
+  }
+
+  return true;
+}
+
+std::optional<size_t> Socket::GetNextChunkSize(size_t max_chunk_size) {
+  size_t length;
+  MessageChunk info;
+  auto found = FindChunk(max_chunk_size, length, info);
+  if (!found.has_value()) {
+    return std::nullopt;
+  }
+
+  return found->size();
+}
+
+bool Socket::ParseHeader(size_t& header_length, size_t& message_length,
+                         FrameHeader& header) {
+  std::string_view data = receive_buffer_.Data();
+
+  if (framing_ == Framing::kBinary) {
+    // fixed-size header, nothing to scan for
+    if (data.size() < kBinaryHeaderSize) {
+      return false;
+    }
+
+    message_length = LoadLittleEndian(data.data(), 4);
+    header.request_id =
+        static_cast<uint32_t>(LoadLittleEndian(data.data() + 4, 4));
+    header.command_id =
+        static_cast<uint16_t>(LoadLittleEndian(data.data() + 8, 2));
+    header.flags = static_cast<uint16_t>(LoadLittleEndian(data.data() + 10, 2));
+    header_length = kBinaryHeaderSize;
+    return true;
+  }
+
+  // a buffer without a header is rejected after a few bytes, not scanned
+  size_t header_end = data.substr(0, kMaxHeaderLength + 1).find(';');
+  if (header_end == std::string_view::npos) {
+    if (data.size() > kMaxHeaderLength) {
+      throw SocketError("invalid message length header");
+    }
+    return false;
+  }
+
+  auto [end, error] =
+      std::from_chars(data.data(), data.data() + header_end, message_length);
+  if (error != std::errc() || end != data.data() + header_end ||
+      header_end == 0) {
+    throw SocketError("invalid message length header");
+  }
+
+  header = FrameHeader();
+  header_length = header_end + 1;
+  return true;
+}
+
+Socket::ReceiveStage Socket::GetReceiveStage() {
+  if (stream_.has_value()) {
+    return ReceiveStage::kBody;
+  }
+  if (receive_buffer_.Data().empty()) {
+    return ReceiveStage::kIdle;
+  }
+
+  size_t header_length;
+  size_t message_length;
+  FrameHeader header;
+  return ParseHeader(header_length, message_length, header)
+             ? ReceiveStage::kBody
+             : ReceiveStage::kHeader;
+}
+
+std::optional<std::string_view> Socket::FindChunk(size_t max_chunk_size,
+                                                  size_t& length,
+                                                  MessageChunk& info) {
+  if (!stream_.has_value()) {
+    size_t header_length;
+    size_t message_length;
+    FrameHeader header;
+    if (!ParseHeader(header_length, message_length, header)) {
+      return std::nullopt;
+    }
+
+    if (message_length > max_chunk_size) {
+      if (message_length > max_streamed_message_size_) {
+        throw SocketError("streamed message is too large");
+      }
 
-    if (fds[0].revents & POLLOUT) {
-      int n =
-          send(GetFileDescriptor(), message_with_header.c_str() + total_sended,
-               message_with_header.size() - total_sended, 0);
+      // the rest of the message is taken chunk by chunk
+      receive_buffer_.Consume(header_length);
+      stream_ = MessageChunk{header, message_length, 0};
+    } else {
+      if (message_length > max_message_size_) {
+        throw SocketError("message is too large");
+      }
 
-      if (n < 0) {
-        throw SocketError("error while writing to socket");
+      std::string_view data = receive_buffer_.Data();
+      size_t received_length = data.size() - header_length;
+      if (received_length < message_length) {
+        // makes room for the rest of the message in one go
+        receive_buffer_.PrepareWrite(message_length - received_length);
+        return std::nullopt;
       }
 
-      total_sended += n;
+      info = MessageChunk{header, message_length, 0};
+      length = header_length + message_length;
+      return data.substr(header_length, message_length);
     }
+  }
 
-    fds[0].revents = 0;
+  std::string_view data = receive_buffer_.Data();
+  size_t chunk_size = std::min(max_chunk_size,
+                               stream_->message_size - stream_->offset);
+  if (data.size() < chunk_size) {
+    receive_buffer_.PrepareWrite(chunk_size - data.size());
+    return std::nullopt;
   }
 
-  return Status::kOk;
+  info = stream_.value();
+  length = chunk_size;
+  return data.substr(0, chunk_size);
+}
+
+Status Socket::Send(const std::string& message, int timeout_msec) {
+  return SendParts({message}, FrameHeader(), timeout_msec);
+}
+
+Status Socket::Send(const std::string& message, const FrameHeader& header,
+                    int timeout_msec) {
+  return SendParts({message}, header, timeout_msec);
+}
+
+Status Socket::SendParts(const std::vector<std::string_view>& parts,
+                         int timeout_msec) {
+  return SendParts(parts, FrameHeader(), timeout_msec);
+}
+
+Status Socket::SendParts(const std::vector<std::string_view>& parts,
+                         const FrameHeader& header, int timeout_msec) {
+  std::lock_guard lock(send_mutex_);
+
+  size_t message_length = 0;
+  for (auto part : parts) {
+    message_length += part.size();
+  }
+  std::string message_length_header =
+      MakeHeader(message_length, framing_, header);
+
+  // header and parts are written straight from their own memory
+  std::vector<struct iovec> buffers;
+  buffers.reserve(parts.size() + 1);
+  buffers.push_back(
+      {message_length_header.data(), message_length_header.size()});
+  for (auto part : parts) {
+    if (!part.empty()) {
+      buffers.push_back({const_cast<char*>(part.data()), part.size()});
+    }
+  }
+
+  return SendBuffers(buffers, MakeDeadline(timeout_msec));
+}
+
+Response<size_t> Socket::SendAvailable(const char* data, size_t size) {
+  struct iovec buffer {
+    const_cast<char*>(data), size
+  };
+  return SendAvailable(&buffer, 1);
+}
+
+Response<size_t> Socket::SendAvailable(const struct iovec* buffers,
+                                       size_t count) {
+  struct msghdr message {};
+  message.msg_iov = const_cast<struct iovec*>(buffers);
+  message.msg_iovlen = std::min<size_t>(count, IOV_MAX);
+
+  ssize_t n = sendmsg(GetFileDescriptor(), &message,
+                      MSG_DONTWAIT | MSG_NOSIGNAL);
+  if (n < 0) {
+    if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+      return Response<size_t>{0, Status::kTimeout};
+    }
+    if (errno == EPIPE || errno == ECONNRESET) {
+      return Response<size_t>{0, Status::kClosed};
+    }
+    throw SocketError("error while writing to socket");
+  }
+
+  return Response<size_t>{size_t(n), Status::kOk};
+}
+
+std::string Socket::MakeHeader(size_t message_length, Framing framing,
+                               const FrameHeader& header) {
+  if (framing == Framing::kText) {
+    return std::to_string(message_length) + ";";
+  }
+
+  if (message_length > std::numeric_limits<uint32_t>::max()) {
+    throw SocketError("message is too long for a binary frame");
+  }
+
+  std::string binary_header(kBinaryHeaderSize, '\0');
+  StoreLittleEndian(binary_header.data(), message_length, 4);
+  StoreLittleEndian(binary_header.data() + 4, header.request_id, 4);
+  StoreLittleEndian(binary_header.data() + 8, header.command_id, 2);
+  StoreLittleEndian(binary_header.data() + 10, header.flags, 2);
+  return binary_header;
 }
 
 void Socket::Close() noexcept {
@@ -240,43 +668,74 @@ void Socket::Close() noexcept {
   }
 }
 
-Response<size_t> Socket::ReadMessageLengthHeader(int timeout_msec) {
-  std::string buffer(256, '\0');
-  size_t readed_bytes = 0;
+Socket::Deadline Socket::MakeDeadline(int timeout_msec) {
+  if (timeout_msec < 0) {
+    return std::nullopt;
+  }
 
+  return std::chrono::steady_clock::now() +
+         std::chrono::milliseconds(timeout_msec);
+}
+
+Status Socket::Wait(short events, const Deadline& deadline) {
   struct pollfd fds[1];
   fds[0].fd = GetFileDescriptor();
-  fds[0].events = POLLIN;
+  fds[0].events = events;
+  fds[0].revents = 0;
+
+  int timeout_msec = -1;
+  if (deadline.has_value()) {
+    // rounded up, so the deadline has passed once poll times out
+    auto left = std::chrono::ceil<std::chrono::milliseconds>(
+        deadline.value() - std::chrono::steady_clock::now());
+    timeout_msec = static_cast<int>(std::max<int64_t>(0, left.count()));
+  }
 
-  while (true) {
-    int status = poll(fds, 1, timeout_msec);
-    if (status < 0) {
-      throw SocketError("error while polling");
-    }
-    if (status == 0) {
-      return Response<size_t>{0, Status::kTimeout};
-    }
+  int status = poll(fds, 1, timeout_msec);
+  if (status < 0) {
+    throw SocketError("error while polling");
+  }
+  if (status == 0) {
+    return Status::kTimeout;
+  }
 
-    if ((fds[0].revents & POLLHUP) || (fds[0].revents & POLLERR)) {
-      return Response<size_t>{0, Status::kClosed};
-    }
+  // readers still get the data which arrived before the hang up
+  if ((fds[0].revents & POLLERR) ||
+      ((fds[0].revents & POLLHUP) && !(events & POLLIN))) {
+    return Status::kClosed;
+  }
 
-    if (fds[0].revents & POLLIN) {
-      int n = recv(GetFileDescriptor(), buffer.data() + readed_bytes++, 1, 0);
-      if (n <= 0) {
-        throw SocketError("error while reading message header length");
-      }
+  return Status::kOk;
+}
 
-      if (buffer[readed_bytes - 1] == ';') {
-        break;
-      }
+Status Socket::SendBuffers(std::vector<struct iovec>& buffers,
+                           const Deadline& deadline) {
+  size_t first_buffer = 0;
+  while (first_buffer != buffers.size()) {
+    Status status = Wait(POLLOUT, deadline);
+    if (status != Status::kOk) {
+      return status;
     }
 
-    fds[0].revents = 0;
+    auto response = SendAvailable(buffers.data() + first_buffer,
+                                  buffers.size() - first_buffer);
+    if (response.status == Status::kClosed) {
+      return Status::kClosed;
+    }
+
+    // skips written buffers and the written prefix of the partial one
+    size_t sended = response.data;
+    while (sended != 0 && sended >= buffers[first_buffer].iov_len) {
+      sended -= buffers[first_buffer++].iov_len;
+    }
+    if (sended != 0) {
+      buffers[first_buffer].iov_base =
+          static_cast<char*>(buffers[first_buffer].iov_base) + sended;
+      buffers[first_buffer].iov_len -= sended;
+    }
   }
 
-  buffer.resize(readed_bytes - 1);
-  return Response<size_t>{std::stoull(buffer), Status::kOk};
+  return Status::kOk;
 }
 
 }  // namespace net
@@ -0,0 +1,118 @@
+#include "include/net/stats.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+
+namespace net {
+
+namespace {
+
+std::atomic<size_t> threads_count = 0;
+
+// Threads are numbered on their first record, so each of them keeps writing
+// to the same shard.
+size_t GetThreadIndex() noexcept {
+  thread_local size_t index = threads_count.fetch_add(1);
+  return index;
+}
+
+}  // namespace
+
+LatencyHistogram::Snapshot::Snapshot() : buckets_{}, count_(0) {}
+
+uint64_t LatencyHistogram::Snapshot::GetCount() const noexcept {
+  return count_;
+}
+
+std::chrono::nanoseconds LatencyHistogram::Snapshot::GetPercentile(
+    double percentile) const noexcept {
+  if (count_ == 0) {
+    return std::chrono::nanoseconds(0);
+  }
+
+  auto rank = static_cast<uint64_t>(percentile / 100 * count_);
+  rank = std::clamp<uint64_t>(rank, 1, count_);
+
+  uint64_t seen = 0;
+  for (size_t bucket = 0; bucket < kBucketsCount; ++bucket) {
+    seen += buckets_[bucket];
+    if (seen >= rank) {
+      return std::chrono::nanoseconds(GetBucketValue(bucket));
+    }
+  }
+
+  return GetMax();
+}
+
+std::chrono::nanoseconds LatencyHistogram::Snapshot::GetMax() const noexcept {
+  for (size_t bucket = kBucketsCount; bucket-- > 0;) {
+    if (buckets_[bucket] != 0) {
+      return std::chrono::nanoseconds(GetBucketValue(bucket));
+    }
+  }
+
+  return std::chrono::nanoseconds(0);
+}
+
+LatencyHistogram::LatencyHistogram(size_t shards_count)
+    : shards_count_(shards_count), shards_() {
+  if (shards_count_ == 0) {
+    shards_count_ = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  // value-initialized, so every counter starts from zero
+  shards_ = std::make_unique<Shard[]>(shards_count_);
+}
+
+void LatencyHistogram::Record(std::chrono::nanoseconds latency) noexcept {
+  uint64_t value = latency.count() < 0 ? 0 : latency.count();
+  Shard& shard = shards_[GetThreadIndex() % shards_count_];
+
+  // threads beyond the number of shards share them, hence the atomic add
+  shard.buckets[GetBucket(value)].fetch_add(1, std::memory_order_relaxed);
+}
+
+LatencyHistogram::Snapshot LatencyHistogram::Read() const noexcept {
+  Snapshot snapshot;
+  for (size_t i = 0; i < shards_count_; ++i) {
+    for (size_t bucket = 0; bucket < kBucketsCount; ++bucket) {
+      uint64_t count =
+          shards_[i].buckets[bucket].load(std::memory_order_relaxed);
+      snapshot.buckets_[bucket] += count;
+      snapshot.count_ += count;
+    }
+  }
+
+  return snapshot;
+}
+
+size_t LatencyHistogram::GetBucket(uint64_t value) noexcept {
+  value = std::min<uint64_t>(value, (uint64_t(1) << kMaxValueBits) - 1);
+  if (value < kSubBucketsCount) {
+    return value;
+  }
+
+  // position of the highest bit, followed by kSubBucketsBits bits of value
+  size_t exponent = 63 - __builtin_clzll(value);
+  size_t shift = exponent - kSubBucketsBits;
+  size_t sub_bucket = (value >> shift) - kSubBucketsCount;
+  return (shift + 1) * kSubBucketsCount + sub_bucket;
+}
+
+uint64_t LatencyHistogram::GetBucketValue(size_t bucket) noexcept {
+  if (bucket < kSubBucketsCount) {
+    return bucket;
+  }
+
+  size_t shift = bucket / kSubBucketsCount - 1;
+  uint64_t sub_bucket = bucket % kSubBucketsCount;
+  uint64_t lowest = (kSubBucketsCount + sub_bucket) << shift;
+  return lowest + ((uint64_t(1) << shift) >> 1);
+}
+
+}  // namespace net
@@ -0,0 +1,79 @@
+#include "include/net/thread_pool.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+namespace net {
+
+ThreadPool::ThreadPool(size_t workers_count, size_t queue_capacity)
+    : queue_capacity_(queue_capacity == 0 ? 1 : queue_capacity),
+      mutex_(),
+      has_tasks_(),
+      has_space_(),
+      tasks_(queue_capacity_),
+      tasks_head_(0),
+      tasks_count_(0),
+      is_stopping_(false),
+      workers_() {
+  workers_count = std::max<size_t>(workers_count, 1);
+
+  workers_.reserve(workers_count);
+  for (size_t i = 0; i < workers_count; ++i) {
+    workers_.emplace_back(&ThreadPool::Work, this);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard lock(mutex_);
+    is_stopping_ = true;
+  }
+  has_tasks_.notify_all();
+
+  for (auto& worker : workers_) {
+    worker.join();
+  }
+}
+
+void ThreadPool::Submit(Task task) {
+  {
+    std::unique_lock lock(mutex_);
+    has_space_.wait(lock, [this] { return tasks_count_ < queue_capacity_; });
+    tasks_[(tasks_head_ + tasks_count_) % queue_capacity_] = std::move(task);
+    ++tasks_count_;
+  }
+  has_tasks_.notify_one();
+}
+
+size_t ThreadPool::GetWorkersCount() const noexcept { return workers_.size(); }
+
+void ThreadPool::Work() {
+  while (true) {
+    Task task;
+    {
+      std::unique_lock lock(mutex_);
+      has_tasks_.wait(lock,
+                      [this] { return is_stopping_ || tasks_count_ != 0; });
+      if (tasks_count_ == 0) {
+        return;
+      }
+
+      task = std::move(tasks_[tasks_head_]);
+      tasks_[tasks_head_] = nullptr;
+      tasks_head_ = (tasks_head_ + 1) % queue_capacity_;
+      --tasks_count_;
+    }
+    has_space_.notify_one();
+
+    try {
+      task();
+    } catch (...) {
+      // ignore
+    }
+  }
+}
+
+}  // namespace net
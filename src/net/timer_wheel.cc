@@ -0,0 +1,170 @@
+#include "include/net/timer_wheel.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "include/net/slot_map.h"
+
+namespace net {
+
+static_assert(TimerWheel::kInvalidId == SlotMap<int>::kInvalidId);
+
+namespace {
+
+constexpr uint64_t kSlotMask = TimerWheel::kSlotsCount - 1;
+
+// Ticks covered by the levels up to the given one.
+constexpr uint64_t GetLevelSpan(size_t level) noexcept {
+  return uint64_t(1) << (TimerWheel::kSlotsBits * (level + 1));
+}
+
+}  // namespace
+
+TimerWheel::TimerWheel(std::chrono::milliseconds tick, Clock::time_point now)
+    : tick_(tick),
+      origin_(now),
+      current_tick_(0),
+      timers_(),
+      slots_(kLevelsCount * kSlotsCount, kInvalidId) {}
+
+TimerWheel::Id TimerWheel::Schedule(Clock::time_point deadline,
+                                    uint64_t payload) {
+  uint64_t tick = 0;
+  if (deadline > origin_) {
+    // rounded up, so the timer doesn't expire before its deadline
+    tick = (deadline - origin_ + tick_ - Clock::duration(1)) / tick_;
+  }
+  // the current tick has expired already
+  tick = std::max(tick, current_tick_ + 1);
+
+  Id id = timers_.Insert(Timer{tick, payload, kInvalidId, kInvalidId, 0});
+  Place(id, *timers_.Find(id));
+  return id;
+}
+
+void TimerWheel::Cancel(Id id) noexcept {
+  Timer* timer = timers_.Find(id);
+  if (timer == nullptr) {
+    return;
+  }
+
+  Unlink(*timer);
+  timers_.Erase(id);
+}
+
+void TimerWheel::Advance(Clock::time_point now,
+                         std::vector<uint64_t>& expired) {
+  uint64_t target = GetTick(now);
+
+  while (current_tick_ < target && !timers_.Empty()) {
+    ++current_tick_;
+
+    // higher levels are moved down once the lower one has made a full turn
+    for (size_t level = 1; level < kLevelsCount; ++level) {
+      if ((current_tick_ & (GetLevelSpan(level - 1) - 1)) != 0) {
+        break;
+      }
+      Cascade(level);
+    }
+
+    // every timer of the slot expires at this very tick
+    Id& head = slots_[current_tick_ & kSlotMask];
+    for (Id id = head; id != kInvalidId;) {
+      Timer timer = timers_.Erase(id);
+      expired.push_back(timer.payload);
+      id = timer.next;
+    }
+    head = kInvalidId;
+  }
+
+  // nothing to expire in between
+  current_tick_ = std::max(current_tick_, target);
+}
+
+std::optional<TimerWheel::Clock::duration> TimerWheel::GetNextTimeout(
+    Clock::time_point now) const {
+  if (timers_.Empty()) {
+    return std::nullopt;
+  }
+
+  // timers of higher levels are moved down at the end of the turn of the
+  // first level, so the wheel has to be advanced then at the latest
+  uint64_t turn_end = (current_tick_ | kSlotMask) + 1;
+  uint64_t tick = current_tick_ + 1;
+  while (tick != turn_end && slots_[tick & kSlotMask] == kInvalidId) {
+    ++tick;
+  }
+
+  return std::max(Clock::duration(0), GetTime(tick) - now);
+}
+
+size_t TimerWheel::Size() const noexcept { return timers_.Size(); }
+
+void TimerWheel::Place(Id id, Timer& timer) {
+  uint64_t ticks_left = timer.tick - current_tick_;
+
+  size_t level = 0;
+  while (level + 1 < kLevelsCount && ticks_left >= GetLevelSpan(level)) {
+    ++level;
+  }
+
+  // beyond the wheel the timer waits in the farthest slot of the top level
+  uint64_t tick = timer.tick;
+  if (ticks_left >= GetLevelSpan(kLevelsCount - 1)) {
+    tick = current_tick_ + GetLevelSpan(kLevelsCount - 1) - 1;
+  }
+
+  timer.slot = level * kSlotsCount +
+               ((tick >> (kSlotsBits * level)) & kSlotMask);
+  timer.previous = kInvalidId;
+  timer.next = slots_[timer.slot];
+  if (timer.next != kInvalidId) {
+    timers_.Find(timer.next)->previous = id;
+  }
+  slots_[timer.slot] = id;
+}
+
+void TimerWheel::Unlink(Timer& timer) {
+  if (timer.previous != kInvalidId) {
+    timers_.Find(timer.previous)->next = timer.next;
+  } else {
+    slots_[timer.slot] = timer.next;
+  }
+
+  if (timer.next != kInvalidId) {
+    timers_.Find(timer.next)->previous = timer.previous;
+  }
+}
+
+void TimerWheel::Cascade(size_t level) {
+  size_t slot = level * kSlotsCount +
+                ((current_tick_ >> (kSlotsBits * level)) & kSlotMask);
+
+  Id id = slots_[slot];
+  slots_[slot] = kInvalidId;
+  while (id != kInvalidId) {
+    Timer& timer = *timers_.Find(id);
+    Id next = timer.next;
+    Place(id, timer);
+    id = next;
+  }
+}
+
+uint64_t TimerWheel::GetTick(Clock::time_point time) const noexcept {
+  if (time <= origin_) {
+    return 0;
+  }
+
+  return (time - origin_) / tick_;
+}
+
+TimerWheel::Clock::time_point TimerWheel::GetTime(
+    uint64_t tick) const noexcept {
+  return origin_ + tick_ * static_cast<Clock::rep>(tick);
+}
+
+}  // namespace net
@@ -2,40 +2,60 @@
 
 #include <algorithm>
 #include <cctype>
+#include <string>
+#include <string_view>
 #include <utility>
 
 std::string Processor::Serialize(const std::string& command,
                                  const std::string& input) const {
-  return command + ";" + input;
+  std::string output;
+  SerializeTo(output, command, input);
+  return output;
+}
+
+void Processor::SerializeTo(std::string& output, std::string_view command,
+                            std::string_view input) const {
+  output.reserve(output.size() + command.size() + 1 + input.size());
+  output.append(command);
+  output.push_back(';');
+  output.append(input);
 }
 
 std::pair<std::string, std::string> Processor::Deserialize(
     const std::string& input) const {
-  size_t pos = input.find(';');
-  if (pos == std::string::npos || input.empty()) {
-    return {"", ""};
-  }
-
-  std::string command = input.substr(0, pos);
+  auto [command, data] = DeserializeView(input);
+  return {std::string(command), std::string(data)};
+}
 
-  std::string data;
-  if (pos != input.size() - 1) {
-    data = input.substr(pos + 1);
+std::pair<std::string_view, std::string_view> Processor::DeserializeView(
+    std::string_view input) const {
+  size_t pos = input.find(';');
+  if (pos == std::string_view::npos || input.empty()) {
+    return {};
   }
 
-  return {command, data};
+  return {input.substr(0, pos), input.substr(pos + 1)};
 }
 
 std::pair<std::string, std::string> Processor::UnpackCommand(
     const std::string& command) const {
+  auto [name, argument] = UnpackCommandView(command);
+  return {std::string(name), std::string(argument)};
+}
+
+std::pair<std::string_view, std::string_view> Processor::UnpackCommandView(
+    std::string_view command) const {
+  auto is_space = [](char c) {
+    return std::isspace(static_cast<unsigned char>(c)) != 0;
+  };
+
   auto command_start = std::find_if_not(command.begin(), command.end(),
-                                        [](char c) { return std::isspace(c); });
-  auto command_end = std::find_if(command_start, command.end(),
-                                  [](char c) { return std::isspace(c); });
+                                        is_space);
+  auto command_end = std::find_if(command_start, command.end(), is_space);
 
-  auto arg_start = std::find_if_not(command_end, command.end(),
-                                    [](char c) { return std::isspace(c); });
+  auto arg_start = std::find_if_not(command_end, command.end(), is_space);
 
-  return {std::string(command_start, command_end),
-          std::string(arg_start, command.end())};
+  return {command.substr(command_start - command.begin(),
+                         command_end - command_start),
+          command.substr(arg_start - command.begin())};
 }